@@ -0,0 +1,54 @@
+
+-- Benchmark of the matrix operations that depend on the BLAS library.
+-- For each operation and each number of threads a line in the format
+-- "Test,Source,Time" is printed, like in benchmarks/results.csv, where
+-- the source is the BLAS library and the number of threads.
+--
+-- Usage: gsl-shell blas-benchmark.lua [N] [threads ...]
+--
+-- Use the script compare-backends.sh to run the benchmark with GSL
+-- Shell built with each BLAS library.
+
+local args = {...}
+local N = tonumber(args[1]) or 1000
+local threads_list = {}
+for k = 2, #args do threads_list[#threads_list+1] = tonumber(args[k]) end
+if #threads_list == 0 then threads_list = {1, parallel.cpu_count()} end
+
+local time = require 'time'
+local format = string.format
+
+local function random_matrix(gen, n, m)
+   return matrix.new(n, m, |i,j| gen:get())
+end
+
+local tests = {
+   {name = 'matmul', prepare = |gen| {random_matrix(gen, N, N), random_matrix(gen, N, N)},
+    run = |a, b| a * b},
+   {name = 'matsolve', prepare = |gen| {random_matrix(gen, N, N), random_matrix(gen, N, 1)},
+    run = |a, b| matrix.solve(a, b)},
+   {name = 'matinv', prepare = |gen| {random_matrix(gen, N, N)},
+    run = |a| matrix.inv(a)},
+}
+
+-- Return the elapsed wall clock time in seconds. The CPU time is not
+-- meaningful since it is summed over the threads.
+local function timeit(f, ...)
+   local t0 = time.ms()
+   f(...)
+   return (time.ms() - t0) / 1000
+end
+
+local info = matrix.blas_info()
+io.stderr:write(format('BLAS library: %s (%s)\n', info.name, info.config))
+
+print('Test,Source,Time')
+for _, nt in ipairs(threads_list) do
+   local used = matrix.set_threads(nt)
+   for _, test in ipairs(tests) do
+      local gen = rng.new()
+      local data = test.prepare(gen)
+      local t = timeit(test.run, unpack(data))
+      print(format('%s N=%d,%s %d threads,%g', test.name, N, info.name, used, t))
+   end
+end
@@ -0,0 +1,23 @@
+#!/bin/bash
+# Build GSL Shell with the GSL reference CBLAS and with OpenBLAS and run
+# the BLAS benchmark with each of them.
+#
+# Usage: bash benchmarks/blas/compare-backends.sh [N] [threads ...]
+# It should be run from the root directory of the project.
+
+set -o errexit
+
+for blas in internal openblas; do
+  builddir=".build-blas-$blas"
+  if [ ! -d "$builddir" ]; then
+    meson setup --buildtype=release -Dblas=$blas "$builddir"
+  fi
+  ninja -C "$builddir"
+
+  rundir="$builddir/run"
+  rm -fr "$rundir"
+  mkdir -p "$rundir/lua"
+  cp "$builddir/src/console/gsl-shell" "$rundir"
+  cp -r data/. "$rundir/lua"
+  "$rundir/gsl-shell" benchmarks/blas/blas-benchmark.lua "$@"
+done
@@ -0,0 +1,81 @@
+
+-- Throughput benchmark of the batched non-linear fits.
+-- The model A exp(-lambda t) + b is fitted to many noisy curves, each
+-- from three starting points, first with a single solver fitting the
+-- curves one after the other and then with num.nlinfit_batch using an
+-- increasing number of threads.
+
+local time = require 'time'
+
+local format = string.format
+
+local n, count = 40, 20000
+local sigma = 0.1
+
+local r = rng.new()
+local data = matrix.new(count, n)
+for k = 1, count do
+   local A, lambda, b = 2 + 4 * r:get(), 0.05 + 0.2 * r:get(), r:get()
+   for i = 1, n do
+      data:set(k, i, A * math.exp(-lambda * (i-1)) + b + rnd.gaussian(r, sigma))
+   end
+end
+
+local x0 = matrix.new(3, 3, function(i, j)
+   return ({{1, 0, 0}, {5, 0.2, 0}, {1, 1, 5}})[i][j]
+end)
+
+-- the function has no upvalues so that it can be used by the workers
+local function fdf(x, f, J, y)
+   local A, lambda, b = x[1], x[2], x[3]
+   for i = 1, #y do
+      local t = i - 1
+      local e = math.exp(-lambda * t)
+      if f then f[i] = (A * e + b - y[i]) / 0.1 end
+      if J then
+         J:set(i, 1, e / 0.1)
+         J:set(i, 2, -t * A * e / 0.1)
+         J:set(i, 3, 1 / 0.1)
+      end
+   end
+end
+
+local function run_single()
+   local s = num.nlinfit {n= n, p= 3}
+   local y = matrix.new(n, 1)
+   local fdf_y = function(x, f, J) return fdf(x, f, J, y) end
+   local sum = 0
+   for k = 1, count do
+      for i = 1, n do y[i] = data:get(k, i) end
+      local best
+      for j = 1, 3 do
+         s:set(fdf_y, matrix.vec {x0:get(j, 1), x0:get(j, 2), x0:get(j, 3)})
+         for iter = 1, 100 do
+            s:iterate()
+            if s:test(0, 1e-8) then break end
+         end
+         if not best or s.chisq < best then best = s.chisq end
+      end
+      sum = sum + best
+   end
+   return sum
+end
+
+local function run_batch(threads)
+   local x, chisq = num.nlinfit_batch {n= n, p= 3, fdf= fdf, x0= x0, data= data, threads= threads}
+   local sum = 0
+   for k = 1, count do sum = sum + chisq[k] end
+   return sum
+end
+
+local t0 = time.ms()
+local sum = run_single()
+local t1 = time.ms()
+print(format('single solver: %d fits/s, sum chisq = %.10g', count * 1000 / (t1 - t0), sum))
+
+for _, threads in ipairs {1, 2, 4, 8} do
+   local t0 = time.ms()
+   local sum = run_batch(threads)
+   local t1 = time.ms()
+   print(format('batch, %d threads: %d fits/s, sum chisq = %.10g', threads, count * 1000 / (t1 - t0), sum))
+end
@@ -0,0 +1,61 @@
+
+-- Benchmark of the batched ODE integration.
+-- The benchmark integrates the Van der Pol differential equation for
+-- many initial conditions, first with a scalar solver for each
+-- trajectory and then with a single batch solver.
+
+local format = string.format
+
+local M = 1000
+local mu = 10.0
+local t0, t1, h0 = 0, 200, 0.01
+
+local r = rng.new()
+local y0 = matrix.new(M, 2, function(j, i) return rnd.gaussian(r, 1) end)
+
+local function f_scalar(t, x, y)
+   return y, -x + mu * y * (1-x^2)
+end
+
+local function f_batch(t, y, dydt, m)
+   for j = 0, m-1 do
+      local x, v = y[j], y[m + j]
+      dydt[j] = v
+      dydt[m + j] = -x + mu * v * (1-x^2)
+   end
+end
+
+local function run_scalar()
+   local s = num.ode {N= 2, eps_abs= 1e-8, method= 'rkf45'}
+   local step = s.step
+   local sum = 0
+   for j = 1, M do
+      s:init(t0, h0, f_scalar, y0:get(j, 1), y0:get(j, 2))
+      while s.t < t1 do
+         step(s, t1)
+      end
+      sum = sum + s.y[1]
+   end
+   return sum
+end
+
+local function run_batch()
+   local s = num.ode {N= 2, eps_abs= 1e-8, method= 'rkf45', batch= M}
+   s:init(t0, h0, f_batch, y0)
+   s:evolve_to(t1)
+   local sum = 0
+   for j = 1, M do
+      local t, x = s:get(j)
+      sum = sum + x
+   end
+   return sum
+end
+
+local c0 = os.clock()
+local sum_scalar = run_scalar()
+local c1 = os.clock()
+local sum_batch = run_batch()
+local c2 = os.clock()
+
+print(format('scalar: %g seconds, sum = %.10g', c1 - c0, sum_scalar))
+print(format('batch:  %g seconds, sum = %.10g', c2 - c1, sum_batch))
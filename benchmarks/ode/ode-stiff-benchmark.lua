@@ -0,0 +1,47 @@
+
+-- Benchmark of the stiff ODE integration.
+-- The benchmark integrates the Robertson chemical kinetics problem and
+-- the Van der Pol equation with mu = 1000 using the implicit TR-BDF2
+-- method. The explicit rkf45 method is used for comparison on a shorter
+-- time interval for the Van der Pol equation.
+
+local format = string.format
+
+local function f_robertson(t, y1, y2, y3)
+   return -0.04*y1 + 1e4*y2*y3, 0.04*y1 - 1e4*y2*y3 - 3e7*y2^2, 3e7*y2^2
+end
+
+local function jac_robertson(t, y1, y2, y3, J)
+   J:set(1, 1, -0.04); J:set(1, 2,  1e4*y3);          J:set(1, 3,  1e4*y2)
+   J:set(2, 1,  0.04); J:set(2, 2, -1e4*y3 - 6e7*y2); J:set(2, 3, -1e4*y2)
+   J:set(3, 1,  0);    J:set(3, 2,  6e7*y2);          J:set(3, 3,  0)
+end
+
+local mu = 1000
+
+local function f_vanderpol(t, x, y)
+   return y, mu * (1 - x^2) * y - x
+end
+
+local function run(name, s, f, t1, ...)
+   local c0 = os.clock()
+   local nsteps = 0
+   s:init(0, 1e-6, f, ...)
+   while s.t < t1 do
+      s:step(t1)
+      nsteps = nsteps + 1
+   end
+   local y = s.y
+   print(format('%-32s %8.3f s %8d steps  y = %g %g', name, os.clock() - c0, nsteps, y[1], y[2]))
+end
+
+run('robertson trbdf2', num.ode {N= 3, eps_abs= 1e-10, eps_rel= 1e-6, method= 'trbdf2'},
+    f_robertson, 1e5, 1, 0, 0)
+run('robertson trbdf2 jacobian', num.ode {N= 3, eps_abs= 1e-10, eps_rel= 1e-6, method= 'trbdf2', jacobian= jac_robertson},
+    f_robertson, 1e5, 1, 0, 0)
+run('vanderpol trbdf2', num.ode {N= 2, eps_abs= 1e-6, eps_rel= 1e-6, method= 'trbdf2'},
+    f_vanderpol, 3000, 2, 0)
+run('vanderpol trbdf2 (t1 = 10)', num.ode {N= 2, eps_abs= 1e-6, eps_rel= 1e-6, method= 'trbdf2'},
+    f_vanderpol, 10, 2, 0)
+run('vanderpol rkf45 (t1 = 10)', num.ode {N= 2, eps_abs= 1e-6, eps_rel= 1e-6, method= 'rkf45'},
+    f_vanderpol, 10, 2, 0)
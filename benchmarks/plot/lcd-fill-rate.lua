@@ -0,0 +1,71 @@
+
+-- Fill-rate benchmark of the subpixel renderer.
+-- A dense line plot, with many noisy curves of thousands of points
+-- each, and a plot with large filled rectangles and ellipses are
+-- rendered off-screen with plot:save at increasing sizes. The time to
+-- render an empty plot of the same size, that includes the image
+-- encoding, is subtracted so that the figures refer to the
+-- rasterization of the curves and of the areas.
+
+local time = require 'time'
+
+local format = string.format
+
+local ncurves, npoints = 40, 5000
+local repeat_count = 5
+local sizes = {{1280, 800}, {2560, 1600}, {3840, 2160}}
+local filename = os.tmpname() .. '.qoi'
+
+local function canvas()
+   local p = graph.canvas()
+   p:limits(0, -2, 1, ncurves + 2)
+   p.sync = false
+   return p
+end
+
+local function lines_plot()
+   local p = canvas()
+   local r = rng.new()
+   for k = 1, ncurves do
+      local ln = graph.path(0, k)
+      local y = k
+      for i = 1, npoints - 1 do
+         y = y + 0.2 * (r:get() - 0.5) - 0.05 * (y - k)
+         ln:line_to(i / (npoints - 1), y)
+      end
+      p:addline(ln, graph.webcolor(k))
+   end
+   return p
+end
+
+local function areas_plot()
+   local p = canvas()
+   for k = 1, 4 do
+      local y0 = (k - 1) * (ncurves + 2) / 4
+      p:add(graph.rect(0, y0, 1, y0 + 6), graph.webcolor(k))
+      p:add(graph.ellipse(0.5, y0 + 3, 0.4, 4), graph.webcolor(k + 4))
+   end
+   return p
+end
+
+local function render_time(p, w, h)
+   local t0 = time.ms()
+   for i = 1, repeat_count do
+      p:save(filename, w, h)
+   end
+   return (time.ms() - t0) / repeat_count
+end
+
+local empty, lines, areas = canvas(), lines_plot(), areas_plot()
+
+for _, size in ipairs(sizes) do
+   local w, h = size[1], size[2]
+   local t_empty = render_time(empty, w, h)
+   for _, case in ipairs {{'lines', lines}, {'areas', areas}} do
+      local name, p = case[1], case[2]
+      local t = render_time(p, w, h) - t_empty
+      print(format('%dx%d %s: %.1f ms, %.1f Mpixel/s', w, h, name, t, w * h / (t * 1000)))
+   end
+end
+
+os.remove(filename)
@@ -0,0 +1,125 @@
+
+-- array-eval.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Array variants of the special functions and of the probability
+-- distributions. The GSL function is evaluated in C over all the
+-- elements of a matrix, using several threads for large matrices.
+
+local ffi = require 'ffi'
+local matrix = require 'matrix'
+
+local gsl_matrix = ffi.typeof('gsl_matrix')
+
+ffi.cdef [[
+extern int gsl_shell_array_eval (int kind, void *fn, const double *params, int nparams,
+                                 const double *x, size_t n1, size_t n2, size_t xtda,
+                                 double *y, size_t ytda, int nthreads);
+]]
+
+-- kind of the function, as defined in array-eval.h, and number of
+-- scalar parameters
+local kinds = {
+   sf_x  = {0, 0},
+   sf_xm = {1, 0},
+   sf_ix = {2, 1},
+   sf_px = {3, 1},
+   x     = {4, 0},
+   xp    = {5, 1},
+   xpp   = {6, 2},
+   kp    = {7, 1},
+   kpu   = {8, 2},
+   kpp   = {9, 2},
+}
+
+local params = ffi.new('double[2]')
+
+local function array_threads(options)
+   local n = options and options.threads
+   if n == nil then n = true end
+   return parallel and parallel.threads(n) or 1
+end
+
+local function array_eval(kind, fn, np, x, y, options)
+   if not ffi.istype(gsl_matrix, x) then
+      error('expecting a real matrix', 3)
+   end
+   local n1, n2 = x.size1, x.size2
+   if y then
+      if not ffi.istype(gsl_matrix, y) or y.size1 ~= n1 or y.size2 ~= n2 then
+         error('the output should be a real matrix of the same size', 3)
+      end
+   else
+      y = matrix.alloc(n1, n2)
+   end
+   local nerrors = ffi.C.gsl_shell_array_eval(kind, fn, params, np, x.data, n1, n2, x.tda,
+                                              y.data, y.tda, array_threads(options))
+   return y, nerrors
+end
+
+local function lookup(kind)
+   local k = kinds[kind]
+   if not k then error('invalid function kind: ' .. kind, 3) end
+   return k[1], k[2]
+end
+
+local M = {}
+
+-- Return the array variant of a special function. The scalar
+-- parameters, if any, come before the matrix of the values like in the
+-- scalar function: f(p, x[, y, options]).
+function M.sf(kind, fn)
+   local id, np = lookup(kind)
+   fn = ffi.cast('void *', fn)
+   if np == 0 then
+      return function(x, y, options)
+         return array_eval(id, fn, 0, x, y, options)
+      end
+   else
+      return function(p, x, y, options)
+         params[0] = p
+         return array_eval(id, fn, 1, x, y, options)
+      end
+   end
+end
+
+-- Return the array variant of a probability density or distribution
+-- function whose parameters come after the values: f(x, p1, p2[, y,
+-- options]).
+function M.randist(kind, fn)
+   local id, np = lookup(kind)
+   fn = ffi.cast('void *', fn)
+   if np == 0 then
+      return function(x, y, options)
+         return array_eval(id, fn, 0, x, y, options)
+      end
+   elseif np == 1 then
+      return function(x, p1, y, options)
+         params[0] = p1
+         return array_eval(id, fn, 1, x, y, options)
+      end
+   else
+      return function(x, p1, p2, y, options)
+         params[0], params[1] = p1, p2
+         return array_eval(id, fn, 2, x, y, options)
+      end
+   end
+end
+
+return M
@@ -4,6 +4,7 @@ local ffi = require 'ffi'
 local gsl = require 'gsl'
 local matrix = require 'matrix'
 local gsl_check = require 'gsl-check'
+local workspace = require 'workspace'
 ------------------------------------------------------------
 
 --Eigensystem struct und function definitions
@@ -319,6 +320,21 @@ gsl_eigen_invert_jacobi(const gsl_matrix * matrix,
 -------------------------------------------------------------------------------
 local eigen = {}
 
+-- estimate of the memory used by the workspaces, in number of doubles
+local workspace_kinds = {
+   symmv    = |n| 4*n,
+   nonsymmv = |n| n*n + 6*n,
+   hermv    = |n| 6*n,
+   gensymmv = |n| 4*n,
+   genhermv = |n| 6*n,
+   genv     = |n| 2*n*n + 7*n,
+}
+
+for name, size in pairs(workspace_kinds) do
+   workspace.register('eigen_' .. name, gsl['gsl_eigen_' .. name .. '_alloc'], gsl['gsl_eigen_' .. name .. '_free'],
+                      |n| size(n) * ffi.sizeof('double'))
+end
+
 local order_lookup = {
    asc      = gsl.GSL_EIGEN_SORT_VAL_ASC,
    desc     = gsl.GSL_EIGEN_SORT_VAL_DESC,
@@ -345,9 +361,9 @@ function eigen.symm(m, order)
    local xeval = gsl.gsl_matrix_column(eval, 0)
    local order_sel = get_order(order)
 
-   local w = gsl.gsl_eigen_symmv_alloc (size)
+   local w = workspace.acquire('eigen_symmv', size)
    gsl_check(gsl.gsl_eigen_symmv (A, xeval, evec, w))
-   gsl.gsl_eigen_symmv_free (w)
+   workspace.release(w)
 
    if order_sel ~= SORT_NONE then
       gsl.gsl_eigen_symmv_sort (xeval, evec, order_sel)
@@ -366,9 +382,9 @@ function eigen.non_symm(m, order)
    local xeval = gsl.gsl_matrix_complex_column(eval, 0)
    local order_sel = get_order(order)
 
-   local w = gsl.gsl_eigen_nonsymmv_alloc (size)
+   local w = workspace.acquire('eigen_nonsymmv', size)
    gsl_check(gsl.gsl_eigen_nonsymmv (A, xeval, evec, w))
-   gsl.gsl_eigen_nonsymmv_free (w)
+   workspace.release(w)
 
    if order_sel ~= SORT_NONE then
       gsl.gsl_eigen_nonsymmv_sort (xeval, evec, order_sel)
@@ -385,9 +401,9 @@ function eigen.herm(m, order, eigenvalues_only)
    local evec = matrix.calloc (size, size)
    local order_sel = get_order(order)
 
-   local w = gsl.gsl_eigen_hermv_alloc (size)
+   local w = workspace.acquire('eigen_hermv', size)
    gsl_check(gsl.gsl_eigen_hermv(A, xeval, evec, w))
-   gsl.gsl_eigen_hermv_free (w)
+   workspace.release(w)
 
    if order_sel ~= SORT_NONE then
       gsl.gsl_eigen_hermv_sort (xeval, evec, order_sel)
@@ -406,9 +422,9 @@ function eigen.gensymm(a, b, order)
    local evec = matrix.alloc (size, size)
    local order_sel = get_order(order)
 
-   local w = gsl.gsl_eigen_gensymmv_alloc (size)
+   local w = workspace.acquire('eigen_gensymmv', size)
    gsl_check(gsl.gsl_eigen_gensymmv(A,B, xeval, evec, w))
-   gsl.gsl_eigen_gensymmv_free (w)
+   workspace.release(w)
 
    if order_sel ~= SORT_NONE then
       gsl.gsl_eigen_gensymmv_sort (xeval, evec, order_sel)
@@ -426,9 +442,9 @@ function eigen.genherm(a, b, order)
    local evec = matrix.calloc (size, size)
    local order_sel = get_order(order)
 
-   local w = gsl.gsl_eigen_genhermv_alloc (size)
+   local w = workspace.acquire('eigen_genhermv', size)
    gsl_check(gsl.gsl_eigen_genhermv(A,B, xeval, evec, w))
-   gsl.gsl_eigen_genhermv_free (w)
+   workspace.release(w)
 
    if order_sel ~= SORT_NONE then
       gsl.gsl_eigen_genhermv_sort (xeval, evec, order_sel)
@@ -450,9 +466,9 @@ function eigen.gen(a, b, order)
    local evec = matrix.calloc (size, size)
    local order_sel = get_order(order)
 
-   local w = gsl.gsl_eigen_genv_alloc (size)
+   local w = workspace.acquire('eigen_genv', size)
    gsl_check(gsl.gsl_eigen_genv(A,B, alpha_vec, beta_vec, evec, w))
-   gsl.gsl_eigen_genv_free (w)
+   workspace.release(w)
 
    if order_sel ~= SORT_NONE then
       gsl.gsl_eigen_genv_sort (alpha_vec, beta_vec, evec, order_sel)
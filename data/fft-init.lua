@@ -1,129 +1,19 @@
 
 local ffi = require 'ffi'
-local bit = require 'bit'
-local gsl = require 'gsl'
 
-local gsl_check = require 'gsl-check'
+local fft_plan = require 'fft-plan'
 
 local check     = require 'check'
 local is_integer = check.is_integer
 
-local tobit, band, rshift = bit.tobit, bit.band, bit.rshift
 local tonumber = tonumber
-
-ffi.cdef [[
-   typedef struct
-   {
-      size_t size;
-      size_t stride;
-      double * data;
-      gsl_block * block;
-   } fft_hc;
-
-   typedef struct
-   {
-      size_t size;
-      size_t stride;
-      double * data;
-      gsl_block * block;
-   } fft_radix2_hc;
-
-   typedef struct
-   {
-      size_t n;
-      size_t nf;
-      size_t factor[64];
-      gsl_complex *twiddle[64];
-      gsl_complex *trig;
-   } gsl_fft_real_wavetable;
-
-   typedef struct
-   {
-      size_t n;
-      double *scratch;
-   } gsl_fft_real_workspace;
-
-   typedef struct
-   {
-      size_t n;
-      size_t nf;
-      size_t factor[64];
-      gsl_complex *twiddle[64];
-      gsl_complex *trig;
-   } gsl_fft_halfcomplex_wavetable;
-
-   gsl_fft_real_wavetable * gsl_fft_real_wavetable_alloc (size_t n);
-
-   void gsl_fft_real_wavetable_free (gsl_fft_real_wavetable * wavetable);
-
-   gsl_fft_halfcomplex_wavetable * gsl_fft_halfcomplex_wavetable_alloc (size_t n);
-
-   void gsl_fft_halfcomplex_wavetable_free (gsl_fft_halfcomplex_wavetable * wavetable);
-
-   gsl_fft_real_workspace * gsl_fft_real_workspace_alloc (size_t n);
-
-   void gsl_fft_real_workspace_free (gsl_fft_real_workspace * workspace);
-
-   int gsl_fft_real_radix2_transform (double data[], const size_t stride,
-                                      const size_t n) ;
-
-   int gsl_fft_halfcomplex_radix2_inverse (double data[],
-                                           size_t stride, size_t n);
-
-   int gsl_fft_real_transform (double data[], const size_t stride, const size_t n,
-                               const gsl_fft_real_wavetable * wavetable,
-                               gsl_fft_real_workspace * work);
-
-   int gsl_fft_halfcomplex_inverse (double data[], const size_t stride, const size_t n,
-                                 const gsl_fft_halfcomplex_wavetable * wavetable,
-                                 gsl_fft_real_workspace * work);
-
-   int gsl_fft_halfcomplex_transform (double data[], const size_t stride, const size_t n,
-                                   const gsl_fft_halfcomplex_wavetable * wavetable,
-                                   gsl_fft_real_workspace * work);
-
-]]
+local min = math.min
 
 local fft_hc        = ffi.typeof('fft_hc')
 local fft_radix2_hc = ffi.typeof('fft_radix2_hc')
 local gsl_matrix    = ffi.typeof('gsl_matrix')
 
-local function is_two_power(n)
-   if n > 0 then
-      local k = tobit(n)
-      while band(k, 1) == 0 do k = rshift(k, 1) end
-      return (k == 1)
-   end
-end
-
-local cache_n = {}
-local cache_r = {}
-
-local function res_allocator(name)
-   local alloc = gsl['gsl_fft_' .. name .. '_alloc']
-   local free  = gsl['gsl_fft_' .. name .. '_free']
-   return function(n)
-             return ffi.gc(alloc(n), free)
-          end
-end
-
-local cache_allocator = {
-   real_wavetable        = res_allocator('real_wavetable'),
-   halfcomplex_wavetable = res_allocator('halfcomplex_wavetable'),
-   real_workspace        = res_allocator('real_workspace')
-}
-
-local function get_resource(name, n)
-   local resource
-   if cache_n[name] ~= n then
-      resource = cache_allocator[name](n)
-      cache_n[name] = n
-      cache_r[name] = resource
-   else
-      resource = cache_r[name]
-   end
-   return resource
-end
+local is_two_power = fft_plan.is_two_power
 
 local function get_matrix_block(x, ip)
    local n = tonumber(x.size1)
@@ -153,31 +43,93 @@ local function get_hc_block(ft, ip)
    return b, data, stride
 end
 
-function num.fft(x, ip)
-   local n = tonumber(x.size1)
-   local b, data, stride = get_matrix_block(x, ip)
-   if is_two_power(n) then
-      gsl_check(gsl.gsl_fft_real_radix2_transform(data, stride, n))
-      return fft_radix2_hc(n, stride, data, b)
+local function plan_transform(p, x, ip)
+   local n = p.n
+   if p.direction == 'forward' then
+      if not ffi.istype(gsl_matrix, x) or tonumber(x.size1) ~= n then
+         error('expecting a column matrix of size ' .. n, 3)
+      end
+      if (ip and tonumber(x.tda) or 1) ~= p.stride then
+         error('the stride of the data does not match the plan', 3)
+      end
+      local b, data, stride = get_matrix_block(x, ip)
+      p:execute(data)
+      return (p.radix2 and fft_radix2_hc or fft_hc)(n, stride, data, b)
+   elseif p.direction == 'inverse' then
+      if tonumber(x.size) ~= n then
+         error('expecting a half-complex vector of size ' .. n, 3)
+      end
+      if (ip and tonumber(x.stride) or 1) ~= p.stride then
+         error('the stride of the data does not match the plan', 3)
+      end
+      local b, data, stride = get_hc_block(x, ip)
+      p:execute(data)
+      return gsl_matrix(n, 1, stride, data, b, 1)
    else
-      local wt = get_resource('real_wavetable', n)
-      local ws = get_resource('real_workspace', n)
-      gsl_check(gsl.gsl_fft_real_transform(data, stride, n, wt, ws))
-      return fft_hc(n, stride, data, b)
-   end      
+      error('transform is available only for real data plans', 3)
+   end
+end
+
+fft_plan.Plan.transform = plan_transform
+
+function num.fft(x, ip)
+   local stride = ip and tonumber(x.tda) or 1
+   return plan_transform(fft_plan.plan(tonumber(x.size1), 'forward', stride), x, ip)
 end
 
 function num.fftinv(ft, ip)
-   local n = tonumber(ft.size)
-   local b, data, stride = get_hc_block(ft, ip)
-   if is_two_power(n) then
-      gsl_check(gsl.gsl_fft_halfcomplex_radix2_inverse(data, stride, n))
-   else
-      local wt = get_resource('halfcomplex_wavetable', n)
-      local ws = get_resource('real_workspace', n)
-      gsl_check(gsl.gsl_fft_halfcomplex_inverse(data, stride, n, wt, ws))
+   local stride = ip and tonumber(ft.stride) or 1
+   return plan_transform(fft_plan.plan(tonumber(ft.size), 'inverse', stride), ft, ip)
+end
+
+function num.fft_plan(n, direction, stride)
+   return fft_plan.plan(n, direction or 'forward', stride)
+end
+
+-- Lua code run by each parallel worker to perform its share of the
+-- rows or of the columns of a 2-D transform.
+local worker_code = [[
+local k, nw, pass, direction, n1, n2, data_addr, tda = ...
+local ffi = require 'ffi'
+local fft_plan = require 'fft-plan'
+local count = (pass == 'rows' and n1 or fft_plan.columns_count(n2))
+local i0, i1 = math.floor((k - 1) * count / nw), math.floor(k * count / nw)
+fft_plan[pass](ffi.cast('double *', data_addr), tda, n1, n2, direction, i0, i1)
+]]
+
+local function fft2_transform(m, direction, options)
+   local n1, n2, tda = tonumber(m.size1), tonumber(m.size2), tonumber(m.tda)
+   local nw = parallel and parallel.threads(options and options.threads) or 1
+   local passes = (direction == 'forward' and {'rows', 'columns'} or {'columns', 'rows'})
+   for _, pass in ipairs(passes) do
+      local count = (pass == 'rows' and n1 or fft_plan.columns_count(n2))
+      local w = min(nw, count)
+      if w <= 1 then
+         fft_plan[pass](m.data, tda, n1, n2, direction, 0, count)
+      else
+         parallel.run(worker_code, w, pass, direction, n1, n2, parallel.address(m.data), tda)
+      end
    end
-   return gsl_matrix(n, 1, stride, data, b, 1)
+end
+
+local function check_real_matrix(m)
+   if not ffi.istype(gsl_matrix, m) then
+      error('expecting a real matrix', 3)
+   end
+end
+
+function num.fft2(m, ip, options)
+   check_real_matrix(m)
+   local r = ip and m or matrix.copy(m)
+   fft2_transform(r, 'forward', options)
+   return r
+end
+
+function num.fft2inv(m, ip, options)
+   check_real_matrix(m)
+   local r = ip and m or matrix.copy(m)
+   fft2_transform(r, 'inverse', options)
+   return r
 end
 
 local function halfcomplex_radix2_index(n, stride, k)
@@ -202,7 +154,7 @@ local function halfcomplex_index(n, stride, k)
    elseif k < half_n then 
       return 1, 2*k-1, 2*k
    elseif k == half_n then
-      return 0, half_n
+      return 0, n-1
    elseif k > half_n then
       return -1, 2*(n-k)-1, 2*(n-k)
    end
@@ -300,6 +252,29 @@ ffi.metatype(fft_radix2_hc, {
              }
           )
 
+-- Return the coefficient (k1, k2) of the 2-D transform "ft" obtained
+-- with num.fft2.
+local function fft2_get(ft, k1, k2)
+   local n1, n2, tda = tonumber(ft.size1), tonumber(ft.size2), tonumber(ft.tda)
+   local conj = (2*k2 > n2)
+   if conj then k1, k2 = (n1 - k1) % n1, n2 - k2 end
+   local re, im = fft_plan.hc_index(n2, k2)
+   local d = ft.data
+   local z
+   if im then
+      z = complex.new(d[k1*tda + re], d[k1*tda + im])
+   else
+      local idx = (is_two_power(n1) and halfcomplex_radix2_index or halfcomplex_index)
+      z = halfcomplex_get(idx, d + re, n1, tda, k1)
+   end
+   return (conj and complex.conj(z) or z)
+end
+
+function num.fft2_unpack(ft)
+   check_real_matrix(ft)
+   return matrix.cnew(tonumber(ft.size1), tonumber(ft.size2), function(i, j) return fft2_get(ft, i-1, j-1) end)
+end
+
 local register_ffi_type = debug.getregistry().__gsl_reg_ffi_type
 
 register_ffi_type(fft_radix2_hc, "radix2 half-complex vector")
@@ -0,0 +1,329 @@
+
+-- fft-plan.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- FFT plans. A plan keeps the GSL wavetable and workspace needed to
+-- transform data of a given length and stride in a given direction. The
+-- plans are cached, keyed by length, stride and direction, so that the
+-- repeated transforms do not allocate them again. The least recently
+-- used plans are dropped from the cache when it is full but they stay
+-- valid as long as they are referenced.
+--
+-- The module also provides the row and column passes of the 2-D real
+-- transforms. It does not depend on the global modules so that it can
+-- be used by the parallel workers.
+
+local ffi = require 'ffi'
+local bit = require 'bit'
+local gsl = require 'gsl'
+
+local gsl_check = require 'gsl-check'
+
+local tobit, band, rshift = bit.tobit, bit.band, bit.rshift
+
+ffi.cdef [[
+   typedef struct
+   {
+      size_t size;
+      size_t stride;
+      double * data;
+      gsl_block * block;
+   } fft_hc;
+
+   typedef struct
+   {
+      size_t size;
+      size_t stride;
+      double * data;
+      gsl_block * block;
+   } fft_radix2_hc;
+
+   typedef struct
+   {
+      size_t n;
+      size_t nf;
+      size_t factor[64];
+      gsl_complex *twiddle[64];
+      gsl_complex *trig;
+   } gsl_fft_real_wavetable;
+
+   typedef struct
+   {
+      size_t n;
+      double *scratch;
+   } gsl_fft_real_workspace;
+
+   typedef struct
+   {
+      size_t n;
+      size_t nf;
+      size_t factor[64];
+      gsl_complex *twiddle[64];
+      gsl_complex *trig;
+   } gsl_fft_halfcomplex_wavetable;
+
+   gsl_fft_real_wavetable * gsl_fft_real_wavetable_alloc (size_t n);
+
+   void gsl_fft_real_wavetable_free (gsl_fft_real_wavetable * wavetable);
+
+   gsl_fft_halfcomplex_wavetable * gsl_fft_halfcomplex_wavetable_alloc (size_t n);
+
+   void gsl_fft_halfcomplex_wavetable_free (gsl_fft_halfcomplex_wavetable * wavetable);
+
+   gsl_fft_real_workspace * gsl_fft_real_workspace_alloc (size_t n);
+
+   void gsl_fft_real_workspace_free (gsl_fft_real_workspace * workspace);
+
+   int gsl_fft_real_radix2_transform (double data[], const size_t stride,
+                                      const size_t n) ;
+
+   int gsl_fft_halfcomplex_radix2_inverse (double data[],
+                                           size_t stride, size_t n);
+
+   int gsl_fft_real_transform (double data[], const size_t stride, const size_t n,
+                               const gsl_fft_real_wavetable * wavetable,
+                               gsl_fft_real_workspace * work);
+
+   int gsl_fft_halfcomplex_inverse (double data[], const size_t stride, const size_t n,
+                                 const gsl_fft_halfcomplex_wavetable * wavetable,
+                                 gsl_fft_real_workspace * work);
+
+   int gsl_fft_halfcomplex_transform (double data[], const size_t stride, const size_t n,
+                                   const gsl_fft_halfcomplex_wavetable * wavetable,
+                                   gsl_fft_real_workspace * work);
+
+   typedef struct
+   {
+      size_t n;
+      size_t nf;
+      size_t factor[64];
+      gsl_complex *twiddle[64];
+      gsl_complex *trig;
+   } gsl_fft_complex_wavetable;
+
+   typedef struct
+   {
+      size_t n;
+      double *scratch;
+   } gsl_fft_complex_workspace;
+
+   gsl_fft_complex_wavetable * gsl_fft_complex_wavetable_alloc (size_t n);
+
+   void gsl_fft_complex_wavetable_free (gsl_fft_complex_wavetable * wavetable);
+
+   gsl_fft_complex_workspace * gsl_fft_complex_workspace_alloc (size_t n);
+
+   void gsl_fft_complex_workspace_free (gsl_fft_complex_workspace * workspace);
+
+   int gsl_fft_complex_radix2_forward (double data[], const size_t stride, const size_t n);
+
+   int gsl_fft_complex_radix2_inverse (double data[], const size_t stride, const size_t n);
+
+   int gsl_fft_complex_forward (double data[], const size_t stride, const size_t n,
+                                const gsl_fft_complex_wavetable * wavetable,
+                                gsl_fft_complex_workspace * work);
+
+   int gsl_fft_complex_inverse (double data[], const size_t stride, const size_t n,
+                                const gsl_fft_complex_wavetable * wavetable,
+                                gsl_fft_complex_workspace * work);
+
+]]
+
+local M = {}
+
+local function is_two_power(n)
+   if n > 0 then
+      local k = tobit(n)
+      while band(k, 1) == 0 do k = rshift(k, 1) end
+      return (k == 1)
+   end
+end
+
+M.is_two_power = is_two_power
+
+local function res_alloc(name, n)
+   local alloc = gsl['gsl_fft_' .. name .. '_alloc']
+   local free  = gsl['gsl_fft_' .. name .. '_free']
+   return ffi.gc(alloc(n), free)
+end
+
+-- wavetable and workspace of the mixed-radix algorithm for each direction
+local plan_resources = {
+   forward         = {'real_wavetable',        'real_workspace'},
+   inverse         = {'halfcomplex_wavetable', 'real_workspace'},
+   complex_forward = {'complex_wavetable',     'complex_workspace'},
+   complex_inverse = {'complex_wavetable',     'complex_workspace'},
+}
+
+local Plan = {}
+Plan.__index = Plan
+
+-- Transform in place the data pointed by "data" using the plan's stride.
+-- The real data are transformed into the half-complex form and back,
+-- the complex data are stored as pairs of real and imaginary parts.
+function Plan.execute(p, data)
+   local n, stride, dir = p.n, p.stride, p.direction
+   if p.radix2 then
+      if dir == 'forward' then
+         gsl_check(gsl.gsl_fft_real_radix2_transform(data, stride, n))
+      elseif dir == 'inverse' then
+         gsl_check(gsl.gsl_fft_halfcomplex_radix2_inverse(data, stride, n))
+      elseif dir == 'complex_forward' then
+         gsl_check(gsl.gsl_fft_complex_radix2_forward(data, stride, n))
+      else
+         gsl_check(gsl.gsl_fft_complex_radix2_inverse(data, stride, n))
+      end
+   else
+      local wt, ws = p.wavetable, p.workspace
+      if dir == 'forward' then
+         gsl_check(gsl.gsl_fft_real_transform(data, stride, n, wt, ws))
+      elseif dir == 'inverse' then
+         gsl_check(gsl.gsl_fft_halfcomplex_inverse(data, stride, n, wt, ws))
+      elseif dir == 'complex_forward' then
+         gsl_check(gsl.gsl_fft_complex_forward(data, stride, n, wt, ws))
+      else
+         gsl_check(gsl.gsl_fft_complex_inverse(data, stride, n, wt, ws))
+      end
+   end
+end
+
+M.Plan = Plan
+
+local function plan_new(n, stride, direction)
+   local p = {n = n, stride = stride, direction = direction, radix2 = is_two_power(n)}
+   if not p.radix2 then
+      local res = plan_resources[direction]
+      p.wavetable = res_alloc(res[1], n)
+      p.workspace = res_alloc(res[2], n)
+   end
+   return setmetatable(p, Plan)
+end
+
+local cache = {}
+local cache_count, cache_limit = 0, 32
+local tick = 0
+
+local function cache_evict(limit)
+   while cache_count > limit do
+      local lru_key, lru_tick
+      for key, p in pairs(cache) do
+         if not lru_tick or p.tick < lru_tick then lru_key, lru_tick = key, p.tick end
+      end
+      cache[lru_key] = nil
+      cache_count = cache_count - 1
+   end
+end
+
+-- Return the plan to transform "n" values with the given stride in the
+-- given direction: "forward" or "inverse" for real data and
+-- "complex_forward" or "complex_inverse" for complex data.
+function M.plan(n, direction, stride)
+   stride = stride or 1
+   if not plan_resources[direction] then
+      error('invalid FFT direction: ' .. tostring(direction), 2)
+   end
+   if n < 1 or n % 1 ~= 0 then
+      error('invalid FFT length', 2)
+   end
+   local key = n .. ':' .. stride .. ':' .. direction
+   local p = cache[key]
+   tick = tick + 1
+   if p then
+      p.tick = tick
+   else
+      p = plan_new(n, stride, direction)
+      p.tick = tick
+      cache[key] = p
+      cache_count = cache_count + 1
+      cache_evict(cache_limit)
+   end
+   return p
+end
+
+-- Set the maximum number of plans kept in the cache.
+function M.set_cache_size(n)
+   cache_limit = n
+   cache_evict(n)
+end
+
+-- Return the indexes of the elements holding the real and imaginary
+-- parts of the k-th coefficient, 0 <= k <= n/2, of a real transform of
+-- length n in half-complex form. The second index is nil if the
+-- coefficient is real.
+function M.hc_index(n, k)
+   if k == 0 then
+      return 0
+   elseif 2*k == n then
+      return (is_two_power(n) and k or n - 1)
+   elseif is_two_power(n) then
+      return k, n - k
+   else
+      return 2*k - 1, 2*k
+   end
+end
+
+-- Number of column jobs of a 2-D transform with n2 columns. The job k
+-- transforms the column, or the pair of columns, of the k-th
+-- coefficient of the rows.
+function M.columns_count(n2)
+   return math.floor(n2 / 2) + 1
+end
+
+-- Transform the rows from i0 to i1 - 1 of the n1 x n2 matrix stored
+-- at "data" with "tda" elements between the rows.
+function M.rows(data, tda, n1, n2, direction, i0, i1)
+   local p = M.plan(n2, direction, 1)
+   for i = i0, i1 - 1 do
+      p:execute(data + i * tda)
+   end
+end
+
+local scratch, scratch_size = nil, 0
+
+-- Perform the column jobs from k0 to k1 - 1 on the matrix whose rows
+-- are already transformed. The columns of the real coefficients are
+-- transformed in place, the pairs of columns of the real and imaginary
+-- parts of the complex coefficients are copied to a buffer to perform
+-- a complex transform.
+function M.columns(data, tda, n1, n2, direction, k0, k1)
+   local rp = M.plan(n1, direction, tda)
+   local cp = M.plan(n1, 'complex_' .. direction, 1)
+   if scratch_size < n1 then
+      scratch, scratch_size = ffi.new('double[?]', 2 * n1), n1
+   end
+   local buf = scratch
+   for k = k0, k1 - 1 do
+      local re, im = M.hc_index(n2, k)
+      if not im then
+         rp:execute(data + re)
+      else
+         for i = 0, n1 - 1 do
+            local o = i * tda
+            buf[2*i], buf[2*i+1] = data[o + re], data[o + im]
+         end
+         cp:execute(buf)
+         for i = 0, n1 - 1 do
+            local o = i * tda
+            data[o + re], data[o + im] = buf[2*i], buf[2*i+1]
+         end
+      end
+   end
+end
+
+return M
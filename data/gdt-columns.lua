@@ -0,0 +1,77 @@
+local ffi = require 'ffi'
+local cgdt = require 'cgdt'
+local gdt_expr = require 'gdt-expr'
+local AST = require 'expr-actions'
+require 'gsl'
+
+ffi.cdef [[
+enum column_status {
+  COLUMN_OK = 0,
+  COLUMN_MISSING,
+  COLUMN_INFINITE,
+  COLUMN_REPEATED,
+  COLUMN_DECREASING,
+  COLUMN_SMALL_STEPS,
+  COLUMN_NOMEM,
+};
+
+extern int    gsl_shell_column_check_increasing (const double *x, size_t n, size_t *index);
+extern size_t gsl_shell_column_drop_missing     (double *x, double *y, size_t n);
+extern double gsl_shell_column_trapezoid        (const double *x, const double *y, size_t n,
+                                                 double x1, double x2);
+extern double gsl_shell_column_simpson          (const double *x, const double *y, size_t n,
+                                                 double x1, double x2);
+extern int    gsl_shell_column_interp_prepare   (double *x, double *y, size_t n, size_t *n_out,
+                                                 size_t *index, double *x_prev);
+extern void   gsl_shell_column_interp_eval      (const gsl_interp *interp, const double *xa,
+                                                 const double *ya, size_t n, const double *x,
+                                                 size_t n1, size_t n2, size_t xtda,
+                                                 double *y, size_t ytda);
+]]
+
+-- Columns of the data tables copied in contiguous buffers to be used
+-- by the numeric kernels written in C. The missing values are stored
+-- as NaN.
+local M = {}
+
+M.kernels = ffi.C
+
+-- Allocate outside of the Lua heap a buffer for n values of the given
+-- type, 'double' by default.
+function M.alloc(n, ctype)
+    ctype = ctype or 'double'
+    local p = ffi.C.malloc(math.max(n, 1) * ffi.sizeof(ctype))
+    if p == nil then error('not enough memory', 2) end
+    return ffi.gc(ffi.cast(ctype .. ' *', p), ffi.C.free)
+end
+
+-- Store in "buf" from "offset" the values of the expression for all the
+-- rows of the table and return the number of missing or non numeric
+-- values. The values of the columns are copied directly by the C
+-- function.
+function M.values(tab, expr, buf, offset)
+    offset = offset or 0
+    local is_var, name, force_enum = AST.is_variable(expr)
+    local j = is_var and not force_enum and tab:col_index(name)
+    if j then
+        return cgdt.gdt_table_get_column(tab, j - 1, buf + offset)
+    end
+    local missing = 0
+    for i = 1, #tab do
+        local v = gdt_expr.eval(tab, expr, i)
+        if type(v) ~= 'number' then
+            v = 0/0
+            missing = missing + 1
+        end
+        buf[offset + i - 1] = v
+    end
+    return missing
+end
+
+-- Return true if the expression is a reference to a column of the table.
+function M.is_column(tab, expr)
+    local is_var, name, force_enum = AST.is_variable(expr)
+    return is_var and not force_enum and tab:col_index(name) ~= nil
+end
+
+return M
@@ -1,57 +1,48 @@
+local ffi = require 'ffi'
 local expr_parse = require 'expr-parse'
-local gdt_expr = require 'gdt-expr'
+local expr_print = require 'expr-print'
 local gdt_factors = require 'gdt-factors'
+local gdt_columns = require 'gdt-columns'
 local AST = require 'expr-actions'
 
-local function tab_integrate(tab, x_expr, y_expr, x1, x2)
-    local n = #tab
-    local x_min, x_max = gdt_expr.eval(tab, x_expr, 1), gdt_expr.eval(tab, x_expr, n)
-    x1 = x1 or x_min
-    x2 = x2 or x_max
-    local sum_y = 0
-    for i = 1, n - 1 do
-        local xi, xip = gdt_expr.eval(tab, x_expr, i), gdt_expr.eval(tab, x_expr, i + 1)
-        if not xi then
-            error("Missing value for " .. x_name .. " at index " .. i)
-        elseif type(xi) ~= "number" then
-            error("Non-numeric value value for " .. x_name .. " at index " .. i)
-        end
-        if xi == xip then
-            error("Repeated value value for " .. x_name .. " at index " .. i .. " and " .. (i + 1))
-        elseif xi > xip then
-            error("Decreasing value value for " .. x_name .. " at index " .. i .. " and " .. (i + 1))
-        end
-        local yi, yip = gdt_expr.eval(tab, y_expr, i), gdt_expr.eval(tab, y_expr, i + 1)
-        if yi and yip then
-            if xi >= x1 and xip <= x2 then
-                sum_y = sum_y + (xip - xi) * (yi + yip) / 2
-            elseif xi <= x2 and xip >= x1 then
-                local dydx = (yip - yi) / (xip - xi)
-                if xi < x1 then
-                    local yi_int = yi + (x1 - xi) * dydx
-                    xi, yi = x1, yi_int
-                end
-                if xip > x2 then
-                    local yip_int = yi + (x2 - xi) * dydx
-                    xip, yip = x2, yip_int
-                end
-                sum_y = sum_y + (xip - xi) * (yi + yip) / 2
-            end
+local C = gdt_columns.kernels
+
+local integrate_rules = {
+    trapezoid = C.gsl_shell_column_trapezoid,
+    simpson   = C.gsl_shell_column_simpson,
+}
+
+local function check_x_values(x, n, x_expr)
+    local index = ffi.new('size_t[1]')
+    local status = C.gsl_shell_column_check_increasing(x, n, index)
+    if status ~= C.COLUMN_OK then
+        local x_name, i = expr_print.expr(x_expr), tonumber(index[0]) + 1
+        if status == C.COLUMN_MISSING then
+            error("Missing or non-numeric value for " .. x_name .. " at index " .. i, 3)
+        elseif status == C.COLUMN_REPEATED then
+            error("Repeated value for " .. x_name .. " at index " .. i .. " and " .. (i + 1), 3)
+        else
+            error("Decreasing value for " .. x_name .. " at index " .. i .. " and " .. (i + 1), 3)
         end
     end
-    return sum_y
 end
 
 -- for compatibility will accept arguments in the form:
 --    gdt_integrate(tab, x_name, y_name[, x1, x2])
 -- this compatibility layer should disappear after the 2.3.5 release
 local function gdt_integrate(tab, expr_formula, x1, x2, arg_adj)
+    local rule
     if type(x1) == "string" then
         local x_name, y_name = expr_formula, x1
         x1, x2 = x2, arg_adj
         expr_formula = y_name .." ~ " .. x_name
+    else
+        rule = arg_adj
     end
 
+    local integrate_rule = integrate_rules[rule or "trapezoid"]
+    if not integrate_rule then error("invalid integration rule: " .. tostring(rule), 2) end
+
     local schema = expr_parse.schema_multivar(expr_formula, AST)
     local x_exprs = gdt_factors.compute(tab, schema.x)
     local y_exprs = gdt_factors.compute(tab, schema.y)
@@ -59,10 +50,20 @@ local function gdt_integrate(tab, expr_formula, x1, x2, arg_adj)
     assert(#x_exprs == 1 and not x_exprs.factor, 'only a single numeric x variable can be given')
     assert(not y_exprs.factor, 'only numeric y variables can be given')
     local x_expr = x_exprs[1].scalar
+
+    local n = #tab
+    local x, y = gdt_columns.alloc(n), gdt_columns.alloc(n)
+    gdt_columns.values(tab, x_expr, x)
+    check_x_values(x, n, x_expr)
+    if n == 0 then return 0 end
+
+    x1 = x1 or x[0]
+    x2 = x2 or x[n - 1]
     local results = {}
     for i, y_expr in ipairs(y_exprs) do
         assert(y_expr.scalar, 'expected a numeric y value')
-        results[i] = tab_integrate(tab, x_expr, y_expr.scalar, x1, x2)
+        gdt_columns.values(tab, y_expr.scalar, y)
+        results[i] = integrate_rule(x, y, n, x1, x2)
     end
     return unpack(results)
 end
@@ -2,12 +2,23 @@ local bit     = require 'bit'
 local cie_lab = require 'cie-lab'
 
 local floor, pi = math.floor, math.pi
+local min, max, abs, sqrt = math.min, math.max, math.abs, math.sqrt
 
 local bor, band, lshift, rshift = bit.bor, bit.band, bit.lshift, bit.rshift
 
 local n_sampling_max = 8192
 local n_sampling_default = 256
 
+-- Parameters of the adaptive sampling: number of initial intervals,
+-- maximum number of subdivisions of each of them, tolerance and
+-- longest segment relative to the size of the view and cosine of the
+-- largest angle between two consecutive segments.
+local adaptive_intervals = 64
+local adaptive_depth = 10
+local adaptive_tolerance = 1e-3
+local adaptive_length = 0.1
+local adaptive_cos_angle = math.cos(pi / 18)
+
 local function check_sampling(n)
    if n then
       if n <= 1 then
@@ -49,9 +60,108 @@ function graph.ipathp(f)
    return ln
 end
 
+local function is_finite(y)
+   return type(y) == 'number' and y - y == 0
+end
+
+-- Write in the path "ln" the curve (x, f(x)) for x going from xi to
+-- xs. The intervals are subdivided where the curve, scaled so that the
+-- view becomes the unit square, departs from the chord more than "tol",
+-- bends by a large angle or makes a long segment. The view is the
+-- rectangle {x1, y1, x2, y2} and the intervals that lie outside of it
+-- are not refined. If it is not given the bounding box of the initial
+-- samples is used. The curve is broken where f is not finite and
+-- where it jumps.
+local function adaptive_sample(ln, f, xi, xs, view, tol)
+   local n = adaptive_intervals
+   local xs0, ys0 = {}, {}
+   for k = 0, n do
+      -- the inner points are moved a little to avoid the aliasing with
+      -- periodic functions
+      local u = (k > 0 and k < n) and k + 0.2 * ((k * 0.618034) % 1 - 0.5) or k
+      local x = xi + u * (xs - xi) / n
+      xs0[k], ys0[k] = x, f(x)
+   end
+
+   local vx1, vy1, vx2, vy2
+   if view then
+      vx1, vy1, vx2, vy2 = view[1], view[2], view[3], view[4]
+   else
+      vx1, vx2 = min(xi, xs), max(xi, xs)
+      for k = 0, n do
+         local y = ys0[k]
+         if is_finite(y) then
+            vy1, vy2 = min(vy1 or y, y), max(vy2 or y, y)
+         end
+      end
+   end
+   local sx = (vx2 > vx1 and 1 / (vx2 - vx1) or 1)
+   local sy = (vy1 and vy2 > vy1 and 1 / (vy2 - vy1) or 1)
+
+   local function outside(xa, ya, xm, ym, xb, yb)
+      return (xa < vx1 and xb < vx1) or (xa > vx2 and xb > vx2) or
+             (ya < vy1 and ym < vy1 and yb < vy1) or
+             (ya > vy2 and ym > vy2 and yb > vy2)
+   end
+
+   local pen = false
+   local function point(x, y)
+      if is_finite(y) then
+         if pen then ln:line_to(x, y) else ln:move_to(x, y) end
+      end
+      pen = is_finite(y)
+   end
+
+   local function refine(xa, ya, xb, yb, depth, lp)
+      local xm = (xa + xb) / 2
+      local ym = f(xm)
+      local fa, fm, fb = is_finite(ya), is_finite(ym), is_finite(yb)
+      local split, jump_a, jump_b = false, false, false
+      if fa and fm and fb then
+         if not (view and outside(xa, ya, xm, ym, xb, yb)) then
+            local ax, ay = (xm - xa) * sx, (ym - ya) * sy
+            local bx, by = (xb - xm) * sx, (yb - ym) * sy
+            local dx, dy = ax + bx, ay + by
+            local la, lb, l = sqrt(ax^2 + ay^2), sqrt(bx^2 + by^2), sqrt(dx^2 + dy^2)
+            local dist = (l > 0 and abs(dx * ay - dy * ax) / l or la)
+            -- the segment does not shrink when it crosses a jump, the
+            -- jump is in the longer of the two halves
+            if l > adaptive_length and l > 0.9 * lp then
+               jump_a, jump_b = la > lb, la <= lb
+            end
+            local bend = (ax * bx + ay * by < adaptive_cos_angle * la * lb)
+            split = la + lb > adaptive_length or dist > tol or (la + lb > tol and bend)
+         end
+      else
+         -- look for the border of the domain of the function
+         split = fa or fm or fb
+      end
+      if split and depth > 0 then
+         local l = sqrt(((xb - xa) * sx)^2 + ((yb - ya) * sy)^2)
+         refine(xa, ya, xm, ym, depth - 1, l)
+         refine(xm, ym, xb, yb, depth - 1, l)
+         return
+      end
+      if jump_a then pen = false end
+      point(xm, ym)
+      if jump_b then pen = false end
+      point(xb, yb)
+   end
+
+   point(xs0[0], ys0[0])
+   for k = 1, n do
+      refine(xs0[k-1], ys0[k-1], xs0[k], ys0[k], adaptive_depth, math.huge)
+   end
+end
+
 function graph.fxline(f, xi, xs, n)
-   n = check_sampling(n)
-   return graph.ipath(iter.sample(f, xi, xs, n))
+   if type(n) == 'number' then
+      n = check_sampling(n)
+      return graph.ipath(iter.sample(f, xi, xs, n))
+   end
+   local ln = graph.path()
+   adaptive_sample(ln, f, xi, xs, n and n.view, n and n.tolerance or adaptive_tolerance)
+   return ln
 end
 
 function graph.filine(f, a, b)
@@ -66,14 +176,67 @@ function graph.xyline(x, y)
    return ln
 end
 
+-- The curves sampled adaptively are stored in the environment of the
+-- plot to be sampled again when its limits change.
 function graph.fxplot(f, xi, xs, color, n)
-   n = check_sampling(n)
    local p = graph.plot()
-   p:addline(graph.ipathp(iter.sample(f, xi, xs, n)), color)
+   if type(n) == 'number' then
+      n = check_sampling(n)
+      p:addline(graph.ipathp(iter.sample(f, xi, xs, n)), color)
+   else
+      local curve = {f = f, xi = xi, xs = xs, path = graph.path(),
+                     tolerance = n and n.tolerance or adaptive_tolerance}
+      adaptive_sample(curve.path, curve.f, xi, xs, n and n.view, curve.tolerance)
+      p:addline(curve.path, color)
+      local env = debug.getfenv(p)
+      env.__fxcurves = env.__fxcurves or {}
+      table.insert(env.__fxcurves, curve)
+   end
    p:show()
    return p
 end
 
+-- Lua code run by each parallel worker of graph.sample_grid on its
+-- share of the rows of the grid.
+local sample_grid_worker = [[
+local k, nw, fcode, x1, y1, dx, dy, nx, ny, z_addr, tda = ...
+local worker = require 'parallel-worker'
+local f = worker.load_function(fcode)
+local z = require('ffi').cast('double *', z_addr)
+local i0, i1 = math.floor((k - 1) * (ny + 1) / nw), math.floor(k * (ny + 1) / nw)
+for i = i0, i1 - 1 do
+   local y, row = y1 + i * dy, i * tda
+   for j = 0, nx do
+      z[row + j] = f(x1 + j * dx, y)
+   end
+end
+]]
+
+-- Return a matrix with ny+1 rows and nx+1 columns with the values of
+-- f(x, y) over a grid of the rectangle. The row i and column j give
+-- the point (x1 + (j-1)*dx, y1 + (i-1)*dy). With the option "threads"
+-- the rows are shared between parallel workers and "f" should be a
+-- function without upvalues.
+function graph.sample_grid(f, x1, y1, x2, y2, nx, ny, options)
+   local dx, dy = (x2 - x1) / nx, (y2 - y1) / ny
+   local m = matrix.alloc(ny + 1, nx + 1)
+   local z, tda = m.data, tonumber(m.tda)
+   local nw = parallel and parallel.threads(options and options.threads) or 1
+   nw = math.min(nw, ny + 1)
+   if nw > 1 then
+      parallel.run(sample_grid_worker, nw, parallel.dump(f), x1, y1, dx, dy,
+                   nx, ny, parallel.address(z), tda)
+   else
+      for i = 0, ny do
+         local y, row = y1 + i * dy, i * tda
+         for j = 0, nx do
+            z[row + j] = f(x1 + j * dx, y)
+         end
+      end
+   end
+   return m
+end
+
 function graph.fiplot(f, a, b, color)
    if not b then a, b, color = 1, a, b end
    local p = graph.plot()
@@ -425,12 +588,29 @@ local function redirect_plot()
    local reg = debug.getregistry()
    local mt = reg['GSL.plot']
    local plot_index = mt.__index
+   local plot_set_limits = plot_index(nil, 'limits')
+
+   -- the curves given by graph.fxplot are sampled again for the new view
+   local function plot_limits(self, x1, y1, x2, y2)
+      plot_set_limits(self, x1, y1, x2, y2)
+      local curves = debug.getfenv(self).__fxcurves
+      if curves then
+         local view = {x1, y1, x2, y2}
+         for _, c in ipairs(curves) do
+            c.path:clear()
+            adaptive_sample(c.path, c.f, c.xi, c.xs, view, c.tolerance)
+         end
+         self:update()
+      end
+   end
 
    local function index_redirect(t, k)
       if k == 'legend' then
          return plot_legend
       elseif k == 'legend_title' then
          return plot_legend_title
+      elseif k == 'limits' then
+         return plot_limits
       end
       return plot_index(t, k)
    end
@@ -10,7 +10,7 @@ local function help_init( ... )
 end
 
 local function open_module(modname)
-	local fullname = string.format('help/%s', modname)
+	local fullname = string.format('help.%s', modname)
 	local m = require(fullname)
 	return m
 end
@@ -1,3 +1,5 @@
+require 'fft-init'
+
 local M = {
    [num.fft] = [[
 num.fft(x[, in_place])
@@ -0,0 +1,89 @@
+
+-- matrix-batch.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Linear systems and inverses of a batch of small matrices stored one
+-- after the other in a matrix. The kernels are generated from the
+-- "lu-small" template for each size and the batch can be split between
+-- parallel workers.
+
+local ffi = require 'ffi'
+local template = require 'template'
+
+local min = math.min
+
+local M = {}
+
+-- largest size of the matrices handled by the generated kernels
+M.max_size = 16
+
+local kernels = {}
+
+local function kernel(n)
+   local k = kernels[n]
+   if not k then
+      k = template.load('lu-small', {N = n})
+      kernels[n] = k
+   end
+   return k
+end
+
+-- Lua code run by each parallel worker on its share of the batch.
+local worker_code = [[
+local k, nw, name, n, count, a_addr, atda, b_addr, btda, r_addr, rtda = ...
+local ffi = require 'ffi'
+local worker = require 'parallel-worker'
+local kernel = worker.cached('lu-small:' .. n, function()
+   return require('template').load('lu-small', {N = n})
+end)
+local i0, i1 = math.floor((k - 1) * count / nw), math.floor(k * count / nw)
+local a, r = ffi.cast('double *', a_addr), ffi.cast('double *', r_addr)
+if name == 'solve' then
+   return kernel.solve(a, atda, ffi.cast('double *', b_addr), btda, r, rtda, i0, i1)
+else
+   return kernel.inv(a, atda, r, rtda, i0, i1)
+end
+]]
+
+-- Compute with the kernel "name", "solve" or "inv", the result of the
+-- batch of matrices "a" and store it in "r". The matrix "b" is the
+-- right hand side for "solve". Return the number of singular matrices.
+function M.run(name, a, b, r, threads)
+   local n = tonumber(a.size2)
+   local count = tonumber(a.size1) / n
+   local nw = min(parallel and parallel.threads(threads) or 1, count)
+   if nw <= 1 then
+      local k = kernel(n)
+      if name == 'solve' then
+         return k.solve(a.data, tonumber(a.tda), b.data, tonumber(b.tda), r.data, tonumber(r.tda), 0, count)
+      else
+         return k.inv(a.data, tonumber(a.tda), r.data, tonumber(r.tda), 0, count)
+      end
+   end
+   local address = parallel.address
+   local results = parallel.run(worker_code, nw, name, n, count,
+                                address(a.data), tonumber(a.tda),
+                                b and address(b.data) or 0, b and tonumber(b.tda) or 0,
+                                address(r.data), tonumber(r.tda))
+   local nsingular = 0
+   for k = 1, nw do nsingular = nsingular + results[k] end
+   return nsingular
+end
+
+return M
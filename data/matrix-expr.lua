@@ -0,0 +1,257 @@
+local ffi = require 'ffi'
+
+local format, concat = string.format, table.concat
+local tonumber = tonumber
+
+-- Lazy element-wise matrix expressions.
+--
+-- The arithmetic operators applied to a lazy expression do not compute
+-- anything but build a tree of nodes. When the expression is evaluated a
+-- single loop computing all the operations is generated for the shape
+-- of the expression and it is cached so that other expressions with the
+-- same shape reuse it. No temporary matrices are needed.
+--
+-- Each node is a table with the fields:
+--   op     the operation: "m" for a matrix, "k" for a scalar, "+", "-",
+--          "*", "/" and "neg" for the operations
+--   lhs, rhs the operands of an operation, rhs is false for "neg"
+--   size1, size2, the dimensions for a matrix expression, false for a scalar
+--   complex true if a complex number or matrix is involved
+--   result  the evaluated expression or false
+--
+-- All the fields are always set since a missing field would be looked up
+-- in the evaluated matrix by the __index metamethod.
+--
+-- The expressions involving complex numbers are evaluated with the
+-- ordinary operators.
+
+local gsl_matrix         = ffi.typeof('gsl_matrix')
+local gsl_matrix_complex = ffi.typeof('gsl_matrix_complex')
+local gsl_complex        = ffi.typeof('complex')
+
+local expr_mt = {}
+
+local function is_expr(x)
+   return getmetatable(x) == expr_mt
+end
+
+local function leaf(x)
+   if is_expr(x) then return x end
+   local e = {op = 'k', value = x, complex = false, size1 = false, size2 = false, result = false}
+   if ffi.istype(gsl_complex, x) then
+      e.complex = true
+   elseif ffi.istype(gsl_matrix, x) or ffi.istype(gsl_matrix_complex, x) then
+      e.op, e.size1, e.size2 = 'm', tonumber(x.size1), tonumber(x.size2)
+      e.complex = ffi.istype(gsl_matrix_complex, x)
+   elseif type(x) ~= 'number' then
+      error('expected matrix or scalar in expression', 3)
+   end
+   return setmetatable(e, expr_mt)
+end
+
+local function node(op, a, b)
+   local e = {op = op, lhs = a, rhs = b or false, complex = a.complex or (b and b.complex) or false, result = false}
+   local n1, n2 = a.size1, a.size2
+   if b and b.size1 then
+      if n1 and (n1 ~= b.size1 or n2 ~= b.size2) then
+         error('incompatible matrix dimensions in expression', 3)
+      end
+      n1, n2 = b.size1, b.size2
+   end
+   e.size1, e.size2 = n1, n2
+   return setmetatable(e, expr_mt)
+end
+
+local kernels = {}
+
+-- Generate the code computing the expression for one element. The
+-- matrices and the scalars found are appended to the list "args".
+local function element_code(e, args, index)
+   local op = e.op
+   if op == 'm' then
+      local k = index[e.value]
+      if not k then
+         args[#args+1] = e.value
+         k = #args
+         index[e.value] = k
+      end
+      return format('d%i[o%i+j]', k, k)
+   elseif op == 'k' then
+      args[#args+1] = e.value
+      return format('x%i', #args)
+   elseif op == 'neg' then
+      return format('(-%s)', element_code(e.lhs, args, index))
+   else
+      local ac = element_code(e.lhs, args, index)
+      local bc = element_code(e.rhs, args, index)
+      return format('(%s%s%s)', ac, op, bc)
+   end
+end
+
+local function kernel_source(code, args)
+   local names, init, offsets = {}, {}, {}
+   for k, x in ipairs(args) do
+      if type(x) == 'number' then
+         names[k] = format('x%i', k)
+      else
+         names[k] = format('m%i', k)
+         init[#init+1] = format('local d%i, t%i = m%i.data, m%i.tda', k, k, k, k)
+         offsets[#offsets+1] = format('local o%i = i*t%i', k, k)
+      end
+   end
+   return format([[
+return function(r, %s)
+   local n1, n2, rd, rt = tonumber(r.size1), tonumber(r.size2), r.data, r.tda
+   %s
+   for i = 0, n1-1 do
+      local ro = i*rt
+      %s
+      for j = 0, n2-1 do
+         rd[ro+j] = %s
+      end
+   end
+end
+]], concat(names, ', '), concat(init, '\n   '), concat(offsets, '\n      '), code)
+end
+
+local function kernel_lookup(e)
+   local args = {}
+   local code = element_code(e, args, {})
+   local kernel = kernels[code]
+   if not kernel then
+      kernel = assert(loadstring(kernel_source(code, args), '=(matrix expression)'))()
+      kernels[code] = kernel
+   end
+   return kernel, args
+end
+
+local eval_node
+
+-- Evaluate an expression with complex values using the ordinary
+-- operators.
+local function eval_complex(e)
+   local op = e.op
+   if op == 'm' or op == 'k' then return e.value end
+   if op == 'neg' then return -eval_node(e.lhs) end
+   local a, b = eval_node(e.lhs), eval_node(e.rhs)
+   if     op == '+' then return a + b
+   elseif op == '-' then return a - b
+   elseif op == '*' then return a * b
+   else                  return a / b end
+end
+
+local function first_matrix(e)
+   if e.op == 'm' then return e.value end
+   return first_matrix(e.lhs.size1 and e.lhs or e.rhs)
+end
+
+local function copy_elements(r, v)
+   local rset, vget = r.set, v.get
+   for i = 1, tonumber(r.size1) do
+      for j = 1, tonumber(r.size2) do
+         rset(r, i, j, vget(v, i, j))
+      end
+   end
+end
+
+-- Evaluate the expression and store the result in the matrix "r" or in a
+-- new matrix if "r" is nil. Return the result.
+function eval_node(e, r)
+   if e.op == 'm' and not r then return e.value end
+   if r and (e.size1 ~= tonumber(r.size1) or e.size2 ~= tonumber(r.size2)) then
+      error('incompatible matrix dimensions in assignment', 3)
+   end
+   if e.complex or not e.size1 then
+      local v = eval_complex(e)
+      if r then copy_elements(r, v) end
+      return r or v
+   end
+   local kernel, args = kernel_lookup(e)
+   r = r or first_matrix(e).alloc(e.size1, e.size2)
+   kernel(r, unpack(args))
+   return r
+end
+
+local function force(e)
+   if not e.result then
+      e.result = eval_node(e)
+   end
+   return e.result
+end
+
+local function expr_op(op)
+   return function(a, b)
+      a, b = leaf(a), leaf(b)
+      if op == '*' and a.size1 and b.size1 then
+         -- product of two matrices, not an element-wise operation
+         return leaf(force(a) * force(b))
+      end
+      if op == '/' and b.size1 then
+         error('invalid operation on matrix', 2)
+      end
+      return node(op, a, b)
+   end
+end
+
+local expr_add = expr_op('+')
+local expr_sub = expr_op('-')
+local expr_mul = expr_op('*')
+local expr_div = expr_op('/')
+
+local function expr_unm(a)
+   return node('neg', leaf(a))
+end
+
+local expr_methods = {
+   eval = force,
+}
+
+expr_mt.__add = expr_add
+expr_mt.__sub = expr_sub
+expr_mt.__mul = expr_mul
+expr_mt.__div = expr_div
+expr_mt.__unm = expr_unm
+
+expr_mt.__index = function(e, k)
+   local method = expr_methods[k]
+   if method then return method end
+   local m = force(e)
+   local v = m[k]
+   if type(v) == 'function' then
+      -- method of the matrix: call it on the evaluated matrix
+      return function(self, ...)
+         if self == e then self = m end
+         return v(self, ...)
+      end
+   end
+   return v
+end
+
+expr_mt.__tostring = function(e)
+   return tostring(force(e))
+end
+
+-- Store in "r" the result of the operation "op" between "r" and "b". The
+-- result is computed in a single pass without temporary matrices.
+local function inplace_op(op)
+   local build = expr_op(op)
+   return function(r, b)
+      eval_node(build(r, b), r)
+      return r
+   end
+end
+
+return {
+   is_expr = is_expr,
+   lazy    = leaf,
+   eval    = function(e) return is_expr(e) and force(e) or e end,
+   assign  = eval_node,
+   add     = expr_add,
+   sub     = expr_sub,
+   mul     = expr_mul,
+   div     = expr_div,
+   add_inplace = inplace_op('+'),
+   sub_inplace = inplace_op('-'),
+   mul_inplace = inplace_op('*'),
+   div_inplace = inplace_op('/'),
+}
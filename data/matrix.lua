@@ -13,8 +13,13 @@ local gsl_matrix_complex = ffi.typeof('gsl_matrix_complex')
 local gsl_complex        = ffi.typeof('complex')
 
 local gsl_check = require 'gsl-check'
+local matrix_expr = require 'matrix-expr'
+local workspace = require 'workspace'
+local matrix_batch = require 'matrix-batch'
 local tonumber = tonumber
 
+local is_expr = matrix_expr.is_expr
+
 local function check_real(x)
    if type(x) ~= 'number' then error('expected real number', 3) end
    return x
@@ -469,8 +474,11 @@ local function opdiv(ar, br, ai, bi)
    end
 end
 
-local function vector_op(scalar_op, element_wise, no_inverse)
+local function vector_op(scalar_op, element_wise, no_inverse, lazy_op)
    return function(a, b)
+             if is_expr(a) or is_expr(b) then
+                return lazy_op(a, b)
+             end
              local ra, sa = get_typeid(a)
              local rb, sb = get_typeid(b)
              if not sb and no_inverse then
@@ -587,10 +595,10 @@ local complex = {
    arg   = complex_arg
 }
 
-local generic_add = vector_op(opadd, true)
-local generic_sub = vector_op(opsub, true)
-local generic_mul = vector_op(opmul, false)
-local generic_div = vector_op(opdiv, true, true)
+local generic_add = vector_op(opadd, true, false, matrix_expr.add)
+local generic_sub = vector_op(opsub, true, false, matrix_expr.sub)
+local generic_mul = vector_op(opmul, false, false, matrix_expr.mul)
+local generic_div = vector_op(opdiv, true, true, matrix_expr.div)
 
 local complex_mt = {
 
@@ -640,6 +648,11 @@ local function matrix_fset(m, f)
 end
 
 local function matrix_set_equal(a, b)
+   if is_expr(b) then
+      matrix_expr.assign(b, a)
+      return
+   end
+
    local n1a, n2a = matrix_dim(a)
    local n1b, n2b = matrix_dim(b)
 
@@ -789,6 +802,9 @@ local matrix = {
 
    transpose = matrix_new_transpose,
    hc        = matrix_new_hc,
+
+   lazy = matrix_expr.lazy,
+   eval = matrix_expr.eval,
 }
 
 local function matrix_sort(m, f)
@@ -796,6 +812,50 @@ local function matrix_sort(m, f)
    algo.quicksort(m.data, 0, n - 1, f)
 end
 
+-- Product of the matrix "r" by the square matrix "b" stored in "r". Each
+-- row of the result is computed in a row buffer and copied back so that
+-- no temporary matrix is needed. The other operands are multiplied
+-- element-wise by the lazy expressions engine.
+local function matrix_mul_inplace(r, b)
+   if is_expr(b) and b.size1 then b = matrix_expr.eval(b) end
+   local br, bs = get_typeid(b)
+   if br == nil or bs then
+      return matrix_expr.mul_inplace(r, b)
+   end
+   local rr = ffi.istype(gsl_matrix, r)
+   if rr and not br then
+      error('cannot store a complex matrix product in a real matrix', 2)
+   end
+   local n1, k = matrix_dim(r)
+   if tonumber(b.size1) ~= k or tonumber(b.size2) ~= k then
+      error('incompatible matrix dimensions in assignment', 2)
+   end
+   if not rr and br then
+      b = mat_complex_of_real(b)
+   elseif b.block == r.block then
+      -- the elements of "b" would be overwritten while computing the rows
+      b = (rr and matrix_copy or matrix_complex_copy)(b)
+   end
+
+   local w = rr and 1 or 2
+   local views = ffi.new(rr and 'gsl_matrix[2]' or 'gsl_matrix_complex[2]')
+   local buf = ffi.new('double[?]', w * k)
+   local row, y = views[0], views[1]
+   row.size1, row.size2, row.tda = 1, k, k
+   y.size1, y.size2, y.tda, y.data = 1, k, k, buf
+   local NT = gsl.CblasNoTrans
+   for i = 0, n1 - 1 do
+      row.data = r.data + w * i * r.tda
+      if rr then
+         gsl_check(gsl.gsl_blas_dgemm(NT, NT, 1, row, b, 0, y))
+      else
+         gsl_check(gsl.gsl_blas_zgemm(NT, NT, 1, row, b, 0, y))
+      end
+      ffi.copy(row.data, buf, w * k * ffi.sizeof('double'))
+   end
+   return r
+end
+
 local matrix_methods = {
    alloc = matrix_alloc,
    dim   = matrix_dim,
@@ -812,6 +872,11 @@ local matrix_methods = {
    slice = matrix_slice,
    sort  = matrix_sort,
    show  = matrix_display_gen(mat_real_get),
+
+   add_inplace = matrix_expr.add_inplace,
+   sub_inplace = matrix_expr.sub_inplace,
+   mul_inplace = matrix_mul_inplace,
+   div_inplace = matrix_expr.div_inplace,
 }
 
 local function matrix_index(m, i)
@@ -882,6 +947,11 @@ local matrix_complex_methods = {
    norm2 = matrix_complex_norm2,
    slice = matrix_complex_slice,
    show  = matrix_display_gen(mat_complex_get),
+
+   add_inplace = matrix_expr.add_inplace,
+   sub_inplace = matrix_expr.sub_inplace,
+   mul_inplace = matrix_mul_inplace,
+   div_inplace = matrix_expr.div_inplace,
 }
 
 local function matrix_complex_index(m, i)
@@ -1007,52 +1077,57 @@ local signum = ffi.new('int[1]')
 local function matrix_inv(m)
    local n = m.size1
    local lu = matrix_copy(m)
-   local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+   local p = workspace.acquire('permutation', n)
    gsl_check(gsl.gsl_linalg_LU_decomp(lu, p, signum))
    local mi = matrix_alloc(n, n)
    gsl_check(gsl.gsl_linalg_LU_invert(lu, p, mi))
+   workspace.release(p)
    return mi
 end
 
 local function matrix_solve(m, b)
    local n = m.size1
    local lu = matrix_copy(m)
-   local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+   local p = workspace.acquire('permutation', n)
    gsl_check(gsl.gsl_linalg_LU_decomp(lu, p, signum))
    local x = matrix_alloc(n, 1)
    local xv = gsl.gsl_matrix_column(x, 0)
    local bv = gsl.gsl_matrix_column(b, 0)
    gsl_check(gsl.gsl_linalg_LU_solve(lu, p, bv, xv))
+   workspace.release(p)
    return x
 end
 
 local function matrix_complex_inv(m)
    local n = m.size1
    local lu = matrix_complex_copy(m)
-   local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+   local p = workspace.acquire('permutation', n)
    gsl_check(gsl.gsl_linalg_complex_LU_decomp(lu, p, signum))
    local mi = matrix_calloc(n, n)
    gsl_check(gsl.gsl_linalg_complex_LU_invert(lu, p, mi))
+   workspace.release(p)
    return mi
 end
 
 local function matrix_complex_solve(m, b)
    local n = m.size1
    local lu = matrix_complex_copy(m)
-   local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+   local p = workspace.acquire('permutation', n)
    gsl_check(gsl.gsl_linalg_complex_LU_decomp(lu, p, signum))
    local x = matrix_calloc(n, 1)
    local xv = gsl.gsl_matrix_complex_column(x, 0)
    local bv = gsl.gsl_matrix_complex_column(b, 0)
    gsl_check(gsl.gsl_linalg_complex_LU_solve(lu, p, bv, xv))
+   workspace.release(p)
    return x
 end
 
 local function matrix_det(m)
   local n = m.size1
   local lu = matrix_copy(m)
-  local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+  local p = workspace.acquire('permutation', n)
   gsl_check(gsl.gsl_linalg_LU_decomp(lu, p, signum))
+  workspace.release(p)
 
   local det = gsl.gsl_linalg_LU_det(lu, signum[0])
   return det
@@ -1061,8 +1136,9 @@ end
 local function matrix_complex_det(m)
   local n = m.size1
   local lu = matrix_complex_copy(m)
-  local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+  local p = workspace.acquire('permutation', n)
   gsl_check(gsl.gsl_linalg_complex_LU_decomp(lu, p, signum))
+  workspace.release(p)
 
   local det = gsl.gsl_linalg_complex_LU_det(lu, signum[0])
   return det
@@ -1071,8 +1147,9 @@ end
 local function matrix_lu(m)
   local n = tonumber(m.size1)
   local lu = matrix_copy(m)
-  local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
+  local p = workspace.acquire('permutation', n)
   gsl_check(gsl.gsl_linalg_LU_decomp(lu, p, signum))
+  workspace.release(p)
   local l = matrix.unit(n)
   local u = matrix_copy(lu)
   for i = 1, n do
@@ -1087,8 +1164,9 @@ end
 local function matrix_complex_lu(m)
   local n = tonumber(m.size1)
   local lu = matrix_complex_copy(m)
-  local p = ffi.gc(gsl.gsl_permutation_alloc(n), gsl.gsl_permutation_free)
-  gsl_check(gsl.gsl_linalg_complex_LU_decomp(lu, p, signum)) 
+  local p = workspace.acquire('permutation', n)
+  gsl_check(gsl.gsl_linalg_complex_LU_decomp(lu, p, signum))
+  workspace.release(p)
   local l = matrix.cunit(n)      
   local u = matrix_complex_copy(lu)
   for i = 1, n do
@@ -1104,7 +1182,7 @@ local function matrix_td_decomp(m)
   local n1 = tonumber(m.size1)
   local n2 = tonumber(m.size2)
 
-  local tau = ffi.gc(gsl.gsl_vector_alloc(n1-1), gsl.gsl_vector_free)
+  local tau = workspace.acquire('vector', n1-1)
   local diag = matrix_alloc(n1,1)
   local sdiag = matrix_alloc(n1-1,1)
   
@@ -1114,6 +1192,7 @@ local function matrix_td_decomp(m)
   local Q = matrix_alloc(n1,n2)
   gsl_check(gsl.gsl_linalg_symmtd_decomp(A,tau))
   gsl_check(gsl.gsl_linalg_symmtd_unpack(A, tau, Q,  dvec, sdvec))
+  workspace.release(tau)
   return Q,diag, sdiag
 end
 
@@ -1121,7 +1200,7 @@ local function matrix_complex_td_decomp(m)
   local n1 = tonumber(m.size1)
   local n2 = tonumber(m.size2)
 
-  local tau = ffi.gc(gsl.gsl_vector_complex_alloc(n1-1), gsl.gsl_vector_complex_free)
+  local tau = workspace.acquire('vector_complex', n1-1)
   local diag = matrix_alloc(n1,1)
   local sdiag = matrix_alloc(n1-1,1)
   local Q = matrix_calloc(n1,n2)
@@ -1132,6 +1211,7 @@ local function matrix_complex_td_decomp(m)
   
   gsl_check(gsl.gsl_linalg_hermtd_decomp(A,tau))
   gsl_check(gsl.gsl_linalg_hermtd_unpack(A, tau, Q,  dvec, sdvec))
+  workspace.release(tau)
   return Q,diag, sdiag
 end
 
@@ -1163,14 +1243,83 @@ function matrix.solve(m, b)
    end
 end
 
+local function check_batch(a)
+   if not ffi.istype(gsl_matrix, a) then
+      error('expecting a real matrix', 3)
+   end
+   local n = tonumber(a.size2)
+   if n == 0 or tonumber(a.size1) % n ~= 0 then
+      error('the number of rows should be a multiple of the number of columns', 3)
+   end
+   return n, tonumber(a.size1) / n
+end
+
+-- Solve the linear systems A_k x = b_k where the matrices A_k are the
+-- blocks of n rows of "a" and the vectors b_k are the rows of "b". The
+-- solutions are returned as the rows of a matrix. Return also the number
+-- of singular matrices, their solution is set to NaN.
+function matrix.solve_batch(a, b, options)
+   local n, count = check_batch(a)
+   if not ffi.istype(gsl_matrix, b) or b.size1 ~= count or b.size2 ~= n then
+      error('the right hand side should be a real matrix of size ' .. count .. 'x' .. n, 2)
+   end
+   local x = matrix_alloc(count, n)
+   if n <= matrix_batch.max_size then
+      return x, matrix_batch.run('solve', a, b, x, options and options.threads)
+   end
+   -- the status of the GSL functions is checked without raising errors
+   -- so that the workspace is always released
+   local nsingular = 0
+   local lu = matrix_alloc(n, n)
+   local p = workspace.acquire('permutation', n)
+   for k = 1, count do
+      gsl.gsl_matrix_memcpy(lu, matrix_slice(a, (k-1)*n + 1, 1, n, n))
+      local xk, bk = gsl.gsl_matrix_row(x, k-1), gsl.gsl_matrix_row(b, k-1)
+      if gsl.gsl_linalg_LU_decomp(lu, p, signum) ~= 0 or
+         gsl.gsl_linalg_LU_solve(lu, p, bk, xk) ~= 0 then
+         for j = 1, n do x:set(k, j, 0/0) end
+         nsingular = nsingular + 1
+      end
+   end
+   workspace.release(p)
+   return x, nsingular
+end
+
+-- Return the inverses of the matrices stored as blocks of n rows in "a"
+-- with the same layout and the number of singular matrices, their
+-- inverse is set to NaN.
+function matrix.inv_batch(a, options)
+   local n, count = check_batch(a)
+   local r = matrix_alloc(count * n, n)
+   if n <= matrix_batch.max_size then
+      return r, matrix_batch.run('inv', a, nil, r, options and options.threads)
+   end
+   local nsingular = 0
+   local lu = matrix_alloc(n, n)
+   local p = workspace.acquire('permutation', n)
+   for k = 1, count do
+      local i0 = (k-1)*n + 1
+      local rk = matrix_slice(r, i0, 1, n, n)
+      gsl.gsl_matrix_memcpy(lu, matrix_slice(a, i0, 1, n, n))
+      if gsl.gsl_linalg_LU_decomp(lu, p, signum) ~= 0 or
+         gsl.gsl_linalg_LU_invert(lu, p, rk) ~= 0 then
+         gsl.gsl_matrix_set_all(rk, 0/0)
+         nsingular = nsingular + 1
+      end
+   end
+   workspace.release(p)
+   return r, nsingular
+end
+
 function matrix.svd(a)
    local m, n = matrix_dim(a)
    local u = matrix_copy(a)
    local v = matrix_alloc(n, n)
    local s = matrix_new(n, n)
    local sv = gsl.gsl_matrix_diagonal(s)
-   local wv = ffi.gc(gsl.gsl_vector_alloc(n), gsl.gsl_vector_free)
+   local wv = workspace.acquire('vector', n)
    gsl_check(gsl.gsl_linalg_SV_decomp (u, v, sv, wv))
+   workspace.release(wv)
    return u, s, v
 end
 
@@ -1185,12 +1334,12 @@ end
 function matrix.qr(m)
    local M,N = m.size1, m.size2
    local QR = matrix_copy(m)
-   local t = matrix_alloc(math.min(tonumber(M),tonumber(N)), 1)
-   local tau = gsl.gsl_matrix_column(t, 0)
+   local tau = workspace.acquire('vector', math.min(tonumber(M),tonumber(N)))
    gsl_check(gsl.gsl_linalg_QR_decomp(QR, tau))
    local Q = matrix_alloc(M, M)
    local R = matrix_alloc(M,N)
    gsl_check(gsl.gsl_linalg_QR_unpack (QR, tau, Q,R))
+   workspace.release(tau)
    return Q,R
 end
 
@@ -1226,11 +1375,12 @@ end
 function matrix.hessenberg_decomp(m)
    local n1 = tonumber(m.size1)
    local n2 = tonumber(m.size2)  
-   local tau = ffi.gc(gsl.gsl_vector_alloc(n1), gsl.gsl_vector_free)
+   local tau = workspace.acquire('vector', n1)
    local A = matrix_copy(m)
    local U = matrix_alloc(n1,n2)
    gsl_check(gsl.gsl_linalg_hessenberg_decomp(A,tau))
    gsl_check(gsl.gsl_linalg_hessenberg_unpack(A, tau, U))
+   workspace.release(tau)
    gsl_check(gsl.gsl_linalg_hessenberg_set_zero(A))
    return A,U
 end
@@ -1240,9 +1390,9 @@ function matrix.hesstri_decomp(a, b)
    local U = matrix_alloc(a.size1, a.size2)
    local B = matrix_copy(b)
    local V = matrix_alloc(b.size1, b.size2)
-   local work = matrix_alloc(a.size1,1)
-   local workvec = gsl.gsl_matrix_column(work, 0)
-   gsl_check(gsl.gsl_linalg_hesstri_decomp(A,B,U,V,workvec))
+   local work = workspace.acquire('vector', a.size1)
+   gsl_check(gsl.gsl_linalg_hesstri_decomp(A,B,U,V,work))
+   workspace.release(work)
    return A,B, U, V
 end
 
@@ -1269,6 +1419,32 @@ matrix.tr = function(a)
 matrix.def  = matrix_def
 matrix.cdef = matrix_cdef
 
+ffi.cdef [[
+extern const char * gsl_shell_blas_name      (void);
+extern const char * gsl_shell_blas_config    (void);
+extern int          gsl_shell_blas_threads   (void);
+extern int          gsl_shell_blas_set_threads (int n);
+]]
+
+-- Set the number of threads used by the BLAS library for the matrix
+-- operations. Return the number of threads actually used.
+function matrix.set_threads(n)
+   check.integer(n)
+   if n < 1 then error('the number of threads should be positive', 2) end
+   return ffi.C.gsl_shell_blas_set_threads(n)
+end
+
+function matrix.blas_info()
+   return {
+      name    = ffi.string(ffi.C.gsl_shell_blas_name()),
+      config  = ffi.string(ffi.C.gsl_shell_blas_config()),
+      threads = ffi.C.gsl_shell_blas_threads(),
+   }
+end
+
+-- pool of the GSL workspaces used by the linear algebra functions
+matrix.workspace = workspace
+
 package.loaded["complex"] = complex
 
 local register_ffi_type = debug.getregistry().__gsl_reg_ffi_type
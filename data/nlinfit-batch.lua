@@ -0,0 +1,150 @@
+
+-- nlinfit-batch.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Batch of non-linear fits of the same model, each one with its own
+-- data and tried from one or more starting points. The fits are split
+-- between the parallel workers and each worker uses its own instance
+-- of the "lmfit" template as workspace.
+
+local ffi = require 'ffi'
+local template = require 'template'
+require 'gsl'
+
+local min = math.min
+
+local gsl_matrix = ffi.typeof('gsl_matrix')
+local double_size = ffi.sizeof('double')
+
+local M = {}
+
+-- Perform the fits from i0 to i1 - 1 using the solver "lm". The layout
+-- "b" gives the pointers and the row strides of the starting points
+-- "x0", of the data, of the results "x", "chisq" and "status". Each fit
+-- is started from all the rows of x0 and the solution with the smallest
+-- residual is kept. The data of the fit and its index are given to
+-- "fdf" as fourth and fifth arguments.
+function M.fit_range(lm, fdf, b, i0, i1)
+   local p, maxiter, epsabs, epsrel = b.p, b.maxiter, b.epsabs, b.epsrel
+   local start = matrix.new(p, 1)
+   local y = b.data ~= nil and matrix.new(b.m, 1) or nil
+   local k
+   local function fdf_k(x, f, J) return fdf(x, f, J, y, k) end
+
+   for i = i0, i1 - 1 do
+      k = i + 1
+      if y then ffi.copy(y.data, b.data + i * b.dtda, b.m * double_size) end
+      local best, best_status
+      for s = 0, b.nstart - 1 do
+         ffi.copy(start.data, b.x0 + s * b.x0tda, p * double_size)
+         lm.set(fdf_k, start)
+         local status = 0
+         for iter = 1, maxiter do
+            local err = lm.iterate()
+            if lm.test(epsabs, epsrel) then status = 1; break end
+            if err then break end
+         end
+         local chisq = lm.chisq()
+         if chisq == 0 then status = 1 end
+         if not best or chisq < best or best ~= best then
+            best, best_status = chisq, status
+            ffi.copy(b.x + i * b.xtda, lm.x.data, p * double_size)
+         end
+      end
+      b.chisq[i], b.status[i] = best, best_status
+   end
+end
+
+-- Lua code run by each parallel worker on its share of the fits.
+local worker_code = [[
+local k, nw, n, p, fcode, count, nstart, x0_addr, x0tda, data_addr, m, dtda,
+      x_addr, xtda, chisq_addr, status_addr, maxiter, epsabs, epsrel = ...
+local ffi = require 'ffi'
+local worker = require 'parallel-worker'
+local batch = require 'nlinfit-batch'
+local lm = worker.cached('lmfit:' .. n .. ':' .. p, function()
+   return require('template').load('lmfit', {N = n, P = p})
+end)
+local fdf = worker.load_function(fcode)
+local function ptr(addr) return addr ~= 0 and ffi.cast('double *', addr) or nil end
+local b = {p = p, nstart = nstart, x0 = ptr(x0_addr), x0tda = x0tda,
+           data = ptr(data_addr), m = m, dtda = dtda,
+           x = ptr(x_addr), xtda = xtda, chisq = ptr(chisq_addr), status = ptr(status_addr),
+           maxiter = maxiter, epsabs = epsabs, epsrel = epsrel}
+local i0, i1 = math.floor((k - 1) * count / nw), math.floor(k * count / nw)
+batch.fit_range(lm, fdf, b, i0, i1)
+]]
+
+-- Return the starting points as a matrix with one point per row. A
+-- single point can be given as a column vector.
+local function starting_points(x0, p)
+   if not ffi.istype(gsl_matrix, x0) then
+      error('"x0" should be a matrix', 3)
+   end
+   local r, c = matrix.dim(x0)
+   if c == p then return x0 end
+   if c == 1 and r == p then
+      return matrix.new(1, p, function(i, j) return x0[j] end)
+   end
+   error('"x0" should have ' .. p .. ' columns', 3)
+end
+
+function M.run(spec)
+   if not spec.n then error 'number of points "n" not specified' end
+   if not spec.p then error 'number of parameters "p" not specified' end
+   if spec.n <= 0 or spec.p <= 0 then
+      error '"n" and "p" shoud be positive integers'
+   end
+   if type(spec.fdf) ~= 'function' then error 'function "fdf" not specified' end
+
+   local n, p = spec.n, spec.p
+   local x0 = starting_points(spec.x0, p)
+   local data = spec.data
+   if data ~= nil and not ffi.istype(gsl_matrix, data) then
+      error '"data" should be a matrix'
+   end
+   local count = spec.count or (data and tonumber(data.size1))
+   if not count then error 'number of fits "count" not specified' end
+   if data and data.size1 < count then error '"data" should have a row for each fit' end
+
+   local x, chisq, status = matrix.new(count, p), matrix.new(count, 1), matrix.new(count, 1)
+   if count == 0 then return x, chisq, status end
+
+   local maxiter = spec.maxiter or 100
+   local epsabs, epsrel = spec.epsabs or 0, spec.epsrel or 1e-8
+   local nw = min(parallel and parallel.threads(spec.threads) or 1, count)
+   if nw <= 1 then
+      local b = {p = p, nstart = tonumber(x0.size1), x0 = x0.data, x0tda = tonumber(x0.tda),
+                 data = data and data.data, m = data and tonumber(data.size2), dtda = data and tonumber(data.tda),
+                 x = x.data, xtda = tonumber(x.tda), chisq = chisq.data, status = status.data,
+                 maxiter = maxiter, epsabs = epsabs, epsrel = epsrel}
+      M.fit_range(template.load('lmfit', {N = n, P = p}), spec.fdf, b, 0, count)
+   else
+      local address = parallel.address
+      parallel.run(worker_code, nw, n, p, parallel.dump(spec.fdf), count,
+                   tonumber(x0.size1), address(x0.data), tonumber(x0.tda),
+                   data and address(data.data) or 0, data and tonumber(data.size2) or 0,
+                   data and tonumber(data.tda) or 0,
+                   address(x.data), tonumber(x.tda), address(chisq.data), address(status.data),
+                   maxiter, epsabs, epsrel)
+   end
+   return x, chisq, status
+end
+
+return M
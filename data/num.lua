@@ -5,6 +5,27 @@ local REG = debug.getregistry()
 
 local num = {}
 
+-- Solver integrating "batch" trajectories of the same ODE system at once
+-- with the state stored in structure-of-arrays form.
+local function ode_batch(method, spec)
+   local batch_methods = {rkf45= 'rkf45batch'}
+   if not batch_methods[method] then
+      error('batch mode not available for ode method: ' .. method)
+   end
+   if type(spec.batch) ~= 'number' or spec.batch < 1 or spec.batch % 1 ~= 0 then
+      error('parameter batch should be a positive integer')
+   end
+   spec.M, spec.batch = spec.batch, nil
+
+   local ode = template.load(batch_methods[method], spec)
+
+   local mt = {
+      __index = {step = ode.step, init = ode.init, evolve_to = ode.evolve_to, get = ode.get, values = ode.values}
+   }
+
+   return setmetatable(ode.new(), mt)
+end
+
 function num.ode(spec)
    local required = {N= 'number', eps_abs= 'number'}
    -- step_min beloy corresponds to an optional minimum step size. Its purpose is
@@ -12,7 +33,7 @@ function num.ode(spec)
    -- limited by "step_min" we accept that the error may be larger than the required
    -- tolerance.
    local defaults = {eps_rel = 0, a_y = 1, a_dydt = 0, step_min = -1}
-   local is_known = {rkf45= true, rk8pd= true}
+   local is_known = {rkf45= true, rk8pd= true, trbdf2= true}
 
    for k, tp in pairs(required) do
       if type(spec[k]) ~= tp then
@@ -27,15 +48,26 @@ function num.ode(spec)
    if not is_known[method] then error('unknown ode method: ' .. method) end
    spec.method = nil
 
+   -- optional Jacobian function used by the implicit methods
+   local jacobian = spec.jacobian
+   spec.jacobian = nil
+
+   if spec.batch then
+      return ode_batch(method, spec)
+   end
+
    local ode = template.load(method, spec)
 
    REG['GSL.help_hook'].ODE = ode
 
    local mt = {
-      __index = {step = ode.step, init = ode.init, evolve = ode.evolve, evolve_to = ode.evolve_to}
+      __index = {step = ode.step, init = ode.init, evolve = ode.evolve, evolve_to = ode.evolve_to,
+                 sample = ode.sample, evolve_until = ode.evolve_until}
    }
 
-   return setmetatable(ode.new(), mt)
+   local s = ode.new()
+   s.jac = jacobian
+   return setmetatable(s, mt)
 end
 
 local NLINFIT_METHODS = {
@@ -72,4 +104,6 @@ function num.nlinfit(spec)
    return s
 end
 
+num.nlinfit_batch = require('nlinfit-batch').run
+
 return num
@@ -0,0 +1,61 @@
+
+-- parallel-init.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Helpers of the "parallel" module to prepare the data sent to the
+-- worker threads. The functions "run", "cpu_count" and "max_workers" are
+-- defined in C.
+
+local ffi = require 'ffi'
+
+local parallel = parallel
+
+-- Return the bytecode of the Lua function "f" so that it can be loaded
+-- by the workers. The function cannot have upvalues since they cannot be
+-- transferred to another Lua state.
+function parallel.dump(f)
+   if type(f) ~= 'function' then
+      error('expecting a Lua function', 2)
+   end
+   local name = debug.getupvalue(f, 1)
+   if name then
+      error('function with upvalues cannot be used by parallel workers: ' .. name, 2)
+   end
+   local ok, code = pcall(string.dump, f)
+   if not ok then
+      error('cannot dump the function for parallel workers: ' .. code, 2)
+   end
+   return code
+end
+
+-- Return the address of the memory pointed by the cdata "p" as a number
+-- that can be passed to the workers.
+function parallel.address(p)
+   return tonumber(ffi.cast('intptr_t', p))
+end
+
+-- Return the number of workers to use when "n" is given as an option.
+-- When "n" is true the number of available processors is used.
+function parallel.threads(n)
+   if n == true then n = parallel.cpu_count() end
+   if not n or n <= 1 then return 1 end
+   return math.min(math.floor(n), parallel.max_workers())
+end
+
+return parallel
@@ -0,0 +1,80 @@
+
+-- parallel-worker.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Module loaded by the Lua states of the parallel workers. It defines
+-- the most common global modules so that the functions sent by the main
+-- Lua state can use them and it keeps the objects that should survive
+-- between the calls.
+
+require('base')
+iter = require('iter')
+matrix = require('matrix')
+complex = require('complex')
+rng = require('rng')
+require('rnd')
+randist = require('randist')
+require('sf')
+
+local M = {}
+
+local cache = {}
+local functions = {}
+
+-- Return the object stored with the given key, calling "create" to make
+-- it the first time.
+function M.cached(key, create)
+   local obj = cache[key]
+   if obj == nil then
+      obj = create()
+      cache[key] = obj
+   end
+   return obj
+end
+
+-- Load the function from the bytecode produced by parallel.dump.
+function M.load_function(code)
+   local f = functions[code]
+   if not f then
+      f = assert(loadstring(code, '=(parallel function)'))
+      functions[code] = f
+   end
+   return f
+end
+
+local worker_rng
+
+-- Return the random number generator of the worker seeded with "seed".
+function M.rng(seed)
+   if not worker_rng then worker_rng = rng.new() end
+   worker_rng:set(seed)
+   return worker_rng
+end
+
+-- Return the k-th of the nw substreams that rng.split gives for a
+-- generator seeded with "seed". Workers called with the same seed get
+-- independent generators and the same sequences at each run.
+function M.stream(seed, k, nw)
+   local r = rng.new()
+   r:set(seed)
+   r:set(r:seeds(nw)[k])
+   return r
+end
+
+return M
@@ -1,10 +1,15 @@
 
-local Pre3d = require 'pre3d.pre3d'
-local ShapeUtils = require 'pre3d.pre3d_shape_utils'
+local ffi = require 'ffi'
 
-local pi = math.pi
 local rgb = graph.rgb
 
+local gsl_matrix = ffi.typeof('gsl_matrix')
+
+ffi.cdef [[
+extern void gsl_shell_graph_lock (void);
+extern void gsl_shell_graph_unlock (void);
+]]
+
 local function opt_gener(options, defaults)
    return function(name)
 	     local t = (options and options[name]) and options or defaults
@@ -12,62 +17,94 @@ local function opt_gener(options, defaults)
 	  end
 end
 
-local function set_transform(ct, rx, ry, dz)
-   ct:reset()
-   ct:rotateZ(0)
-   ct:rotateX(rx)
-   ct:rotateY(ry)
-   ct:translate(0, 0, dz and -dz or -80)
+-- Mesh for a grid of (nu+1) x (nv+1) points with the vertex coordinates
+-- given by "coords(i, j)". Each cell of the grid is divided in two
+-- triangles. The buffers of the mesh are read by the windows while they
+-- are drawn so they are written with the graphics lock held, the
+-- coordinates are computed before since "coords" may raise an error.
+local function grid_mesh(nu, nv, coords)
+   local nvert = (nu+1)*(nv+1)
+   local m = graph.mesh(nvert, 2*nu*nv)
+   local vb, tb = m:buffers()
+   local v, t = ffi.cast('double *', vb), ffi.cast('unsigned int *', tb)
+
+   local vc = ffi.new('double[?]', 3 * nvert)
+   for i = 0, nu do
+      for j = 0, nv do
+	 local k = 3 * (i*(nv+1) + j)
+	 vc[k], vc[k+1], vc[k+2] = coords(i, j)
+      end
+   end
+
+   ffi.C.gsl_shell_graph_lock()
+   ffi.copy(v, vc, 3 * nvert * ffi.sizeof('double'))
+   local k = 0
+   for i = 0, nu-1 do
+      for j = 0, nv-1 do
+	 local i0 = i*(nv+1) + j
+	 local i1 = i0 + (nv+1)
+	 t[k], t[k+1], t[k+2] = i0, i1, i1+1
+	 t[k+3], t[k+4], t[k+5] = i0, i1+1, i0+1
+	 k = k + 6
+      end
+   end
+   ffi.C.gsl_shell_graph_unlock()
+
+   m:update()
+   return m
 end
 
-local function render_shape(shape, plt, stroke)
-   local renderer = Pre3d.Renderer(plt)
-
-   renderer.draw_overdraw = true 
-   renderer.draw_backfaces = true
-   renderer.fill_rgba = rgb(0x4A, 0x92, 0xBF)
-   renderer.fill_rgba_backside = rgb(0xBF, 0x92, 0x4A)
-   if stroke then renderer.stroke_rgba = rgb(50, 50, 50) end
-   renderer.set_light_intensity = true
-
-   renderer.camera.focal_length = 30;
-
-   set_transform(renderer.camera.transform, -pi/2 + pi/16, -pi/16)
-
-   renderer:bufferShape(shape)
-   renderer:drawBuffer()
-   renderer:emptyBuffer()
-   
-   return renderer
+local function render_mesh(m, title, stroke)
+   local plt = graph.plot(title)
+   if stroke then
+      m:colors(rgb(0xBF, 0x92, 0x4A), rgb(50, 50, 50))
+   else
+      m:colors(rgb(0xBF, 0x92, 0x4A))
+   end
+   plt:add(m, rgb(0x4A, 0x92, 0xBF))
+   plt:show()
+   return plt, m
 end
 
 function graph.plot3d(f, x1, y1, x2, y2, options)
-   local opt = opt_gener(options, {title= 'Pre3d', gridx= 20, gridy= 20})
-
-   local plt = graph.plot(opt 'title')
-   local nx = opt 'gridx'
-   local ny = opt 'gridy'
-
-   local shape = ShapeUtils.makeXYFunction(f, x1, y1, x2, y2, nx, ny)
-
-   render_shape(shape, plt, opt 'stroke')
-
-   plt:show()
-   return plt
+   local opt = opt_gener(options, {gridx= 20, gridy= 20})
+   local nx, ny = opt 'gridx', opt 'gridy'
+
+   -- the function can be given as a matrix of samples over the grid
+   local samples = f
+   if not ffi.istype(gsl_matrix, f) then
+      samples = graph.sample_grid(f, x1, y1, x2, y2, nx, ny, {threads= opt 'threads'})
+   end
+   ny, nx = tonumber(samples.size1) - 1, tonumber(samples.size2) - 1
+
+   local zdata, tda = samples.data, tonumber(samples.tda)
+   local zmin, zmax
+   for i = 0, ny do
+      for j = 0, nx do
+	 local z = zdata[i*tda + j]
+	 if not zmin or z < zmin then zmin = z end
+	 if not zmax or z > zmax then zmax = z end
+      end
+   end
+
+   -- the domain is mapped to the unit square and the z range to [0, 1/2]
+   local zscale = (zmax > zmin and 2*(zmax - zmin) or 1)
+   local m = grid_mesh(nx, ny, function(i, j)
+      return i/nx, j/ny, (zdata[j*tda + i] - zmin)/zscale
+   end)
+
+   return render_mesh(m, opt 'title', opt 'stroke')
 end
 
 function graph.surfplot(fs, u1, v1, u2, v2, options)
-   local opt = opt_gener(options, {title= 'Pre3d', gridu= 20, gridv= 20})
-
-   local plt = graph.plot(opt 'title')
-   local nu = opt 'gridu'
-   local nv = opt 'gridv'
+   local opt = opt_gener(options, {gridu= 20, gridv= 20})
+   local nu, nv = opt 'gridu', opt 'gridv'
 
    local x, y, z = fs[1], fs[2], fs[3]
-   local shape = ShapeUtils.makeUVSurface(x, y, z, u1, v1, u2, v2, nu, nv)
-
-   render_shape(shape, plt, opt 'stroke')
+   local m = grid_mesh(nu, nv, function(i, j)
+      local u, v = u1 + (u2 - u1)*i/nu, v1 + (v2 - v1)*j/nv
+      return x(u, v), y(u, v), z(u, v)
+   end)
 
-   plt:show()
-   return plt
+   return render_mesh(m, opt 'title', opt 'stroke')
 end
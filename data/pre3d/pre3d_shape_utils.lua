@@ -28,7 +28,7 @@
 
 use 'math'
 
-local Pre3d = require 'pre3d/pre3d'
+local Pre3d = require 'pre3d.pre3d'
 
 -- TODO(deanm): Having to import all the math like this is a bummer.
 local crossProduct = Pre3d.Math.crossProduct;
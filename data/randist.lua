@@ -165,4 +165,32 @@ local M = {
    hypergeometric_Q = gsl.gsl_cdf_hypergeometric_Q,
 }
 
+-- Array variants of the densities and distribution functions, evaluated
+-- in C over all the elements of a matrix: name_array(x, p1, p2[, y,
+-- options]). The kind gives the types of the arguments: "x" for the
+-- real values, "k" for the integer values, "p" and "u" for the real and
+-- integer parameters.
+local array_kinds = {
+   ugaussian = 'x', landau = 'x',
+   gaussian = 'xp', exponential = 'xp', cauchy = 'xp', chisq = 'xp',
+   ugaussian_tail = 'xp', rayleigh = 'xp', tdist = 'xp', laplace = 'xp', logistic = 'xp',
+   beta = 'xpp', exppow = 'xpp', erlang = 'xpp', fdist = 'xpp', flat = 'xpp',
+   gamma = 'xpp', gaussian_tail = 'xpp', gumbel1 = 'xpp', gumbel2 = 'xpp',
+   lognormal = 'xpp', pareto = 'xpp', rayleigh_tail = 'xpp', weibull = 'xpp',
+   bernoulli = 'kp', geometric = 'kp', logarithmic = 'kp', poisson = 'kp',
+   binomial = 'kpu', pascal = 'kpu', negative_binomial = 'kpp',
+}
+
+local array_eval = require 'array-eval'
+
+local array_variants = {}
+for name, fn in pairs(M) do
+   local dist = name:match('^(.-)_[%a]+$')
+   local kind = array_kinds[dist]
+   if kind then
+      array_variants[name .. '_array'] = array_eval.randist(kind, fn)
+   end
+end
+for name, f in pairs(array_variants) do M[name] = f end
+
 return M
@@ -0,0 +1,104 @@
+
+-- rnd-fill.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Generation of the random variates of a distribution for all the
+-- elements of a matrix. The loop over the elements is done in C, and
+-- in several threads when a table of generators is given.
+
+local ffi = require 'ffi'
+local gsl = require 'gsl'
+
+local select = select
+
+local gsl_matrix = ffi.typeof('gsl_matrix')
+local gsl_rng = ffi.typeof('gsl_rng')
+
+ffi.cdef [[
+extern void gsl_shell_rnd_fill (int kind, void *fn, gsl_rng **rs, int nr,
+                                const double *params, int nparams,
+                                double *y, size_t n1, size_t n2, size_t ytda);
+]]
+
+-- kind of each distribution, as defined in rnd-fill.h, and number of
+-- parameters
+local D0, D1, D2, D3, DU, U1, UDU, UUU = {0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 1}, {5, 1}, {6, 2}, {7, 3}
+
+local kinds = {
+   ugaussian = D0, ugaussian_ratio_method = D0, landau = D0,
+   exponential = D1, cauchy = D1, chisq = D1, gaussian = D1,
+   gaussian_ratio_method = D1, gaussian_ziggurat = D1, ugaussian_tail = D1,
+   logistic = D1, rayleigh = D1, tdist = D1, laplace = D1,
+   beta = D2, exppow = D2, erlang = D2, fdist = D2, flat = D2, gamma = D2,
+   gamma_mt = D2, gamma_knuth = D2, gaussian_tail = D2, gumbel1 = D2,
+   gumbel2 = D2, lognormal = D2, pareto = D2, rayleigh_tail = D2, levy = D2,
+   weibull = D2,
+   levy_skew = D3,
+   gamma_int = DU,
+   bernoulli = U1, geometric = U1, logarithmic = U1, poisson = U1,
+   binomial = UDU, binomial_knuth = UDU, binomial_tpe = UDU, pascal = UDU,
+   hypergeometric = UUU,
+}
+
+local params = ffi.new('double[3]')
+local rs_buffer, rs_size = nil, 0
+
+-- Return an array with the generators given either as a single one or
+-- as a table like the one returned by rng.split.
+local function generators(r)
+   if ffi.istype(gsl_rng, r) then
+      if rs_size < 1 then rs_buffer, rs_size = ffi.new('gsl_rng *[1]'), 1 end
+      rs_buffer[0] = r
+      return rs_buffer, 1
+   elseif type(r) == 'table' and #r > 0 then
+      local n = #r
+      if rs_size < n then rs_buffer, rs_size = ffi.new('gsl_rng *[?]', n), n end
+      for k = 1, n do
+         if not ffi.istype(gsl_rng, r[k]) then return nil end
+         rs_buffer[k-1] = r[k]
+      end
+      return rs_buffer, n
+   end
+end
+
+-- Fill the matrix m with random variates of the distribution "name"
+-- using the generator r given after the parameters:
+-- fill(m, 'gaussian', sigma, r). If r is a table of generators the
+-- elements are divided in as many ranges, each one filled with its own
+-- generator in a separate thread.
+local function fill(m, name, ...)
+   if not ffi.istype(gsl_matrix, m) then
+      error('bad argument #1 to rnd.fill (real matrix expected)', 2)
+   end
+   local kind = kinds[name]
+   if not kind then error('unknown distribution: ' .. tostring(name), 2) end
+   local id, np = kind[1], kind[2]
+   local nargs = select('#', ...)
+   if nargs ~= np + 1 then
+      error(string.format('rnd.fill: %s requires %d parameters and a generator', name, np), 2)
+   end
+   for k = 1, np do params[k-1] = select(k, ...) end
+   local rs, nr = generators(select(nargs, ...))
+   if not rs then error('bad argument to rnd.fill (RNG or table of RNG expected)', 2) end
+   ffi.C.gsl_shell_rnd_fill(id, ffi.cast('void *', gsl['gsl_ran_' .. name]), rs, nr,
+                            params, np, m.data, m.size1, m.size2, m.tda)
+   return m
+end
+
+return {fill = fill}
@@ -3,6 +3,11 @@ local gsl = require 'gsl'
 local ffi = require 'ffi'
 
 local format, tonumber = string.format, tonumber
+local floor = math.floor
+
+ffi.cdef [[
+extern void gsl_shell_rng_skip (const gsl_rng *r, double n);
+]]
 
 local M = {}
 
@@ -12,6 +17,38 @@ local function rng_getint(r, seed)
    return tonumber(gsl.gsl_rng_uniform_int(r, seed))
 end
 
+-- Advance the generator by n draws, like if gsl_rng_get was called n
+-- times, and return it.
+local function rng_jump(r, n)
+   ffi.C.gsl_shell_rng_skip(r, n)
+   return r
+end
+
+-- Return a table of k distinct non-zero seeds drawn from the generator.
+local function rng_seeds(r, k)
+   local seeds, used = {}, {}
+   while #seeds < k do
+      local s = floor(gsl.gsl_rng_uniform(r) * 4294967296)
+      if s > 0 and not used[s] then
+         seeds[#seeds+1], used[s] = s, true
+      end
+   end
+   return seeds
+end
+
+-- Return a table of k new generators of the same type of r seeded with
+-- the seeds drawn from r. The substreams depend only on the state of r
+-- so they are reproducible and can be given to the parallel workers.
+local function rng_split(r, k)
+   local seeds, rs = rng_seeds(r, k), {}
+   for i = 1, k do
+      local s = ffi.gc(gsl.gsl_rng_alloc(r.type), gsl.gsl_rng_free)
+      gsl.gsl_rng_set(s, seeds[i])
+      rs[i] = s
+   end
+   return rs
+end
+
 local rng_mt = {
    __tostring = function(s)
                    return format("<random number generator: %p>", s)
@@ -21,6 +58,9 @@ local rng_mt = {
       getint = rng_getint,
       get    = gsl.gsl_rng_uniform,
       set    = gsl.gsl_rng_set,
+      jump   = rng_jump,
+      split  = rng_split,
+      seeds  = rng_seeds,
    },
 }
 
@@ -47,6 +87,10 @@ function M.new(s)
    return ffi.gc(gsl.gsl_rng_alloc(T), gsl.gsl_rng_free)
 end
 
+M.jump = rng_jump
+M.split = rng_split
+M.seeds = rng_seeds
+
 function M.list()
    local t = {}
    local ts = gsl.gsl_rng_types_setup()
@@ -13,6 +13,38 @@ do
 end
 package.path = DATADIR .. '/templates/?.lua.in;' .. package.path
 
+-- When a precompiled bytecode bundle is installed alongside the Lua files
+-- the modules are loaded from it instead of being parsed from the sources.
+-- The variable GSL_SHELL_NOBUNDLE can be set to ignore the bundle.
+do
+  local bundle = loadfile(DATADIR .. '/gsl-shell.luab')
+  if bundle and not os.getenv('GSL_SHELL_NOBUNDLE') then
+    local modules, templates = bundle()
+    for name, bc in pairs(modules) do
+      package.preload[name] = function(...)
+        return assert(loadstring(bc))(...)
+      end
+    end
+    package.loaded['bytecode-bundle'] = {modules = modules, templates = templates}
+  end
+end
+
+-- Install in the table "t" a stub for each function in "names" that loads
+-- the module "modname" when first called.
+local function lazy_require(modname, t, names)
+  for _, name in ipairs(names) do
+    local stub
+    stub = function(...)
+      local m = require(modname)
+      local f = (type(m) == 'table' and m or t)[name]
+      if f == stub then error('module ' .. modname .. ' does not define ' .. name) end
+      t[name] = f
+      return f(...)
+    end
+    t[name] = stub
+  end
+end
+
 require('base')
 iter = require('iter')
 matrix = require('matrix')
@@ -22,7 +54,7 @@ num = require('num')
 rng = require('rng')
 require('rnd')
 require('integ-init')
-require('fft-init')
+lazy_require('fft-init', num, {'fft', 'fftinv', 'fft_plan', 'fft2', 'fft2inv', 'fft2_unpack'})
 if graph then
   require('graph-init')
 end
@@ -30,13 +62,15 @@ randist = require('randist')
 require('import')
 require('sf')
 require('help')
+require('parallel-init')
 require('vegas')
 gdt = require('gdt')
 require('gdt-parse-csv')
 if graph then
-  require('contour')
+  contour = {}
+  lazy_require('contour', contour, {'plot', 'polar_plot'})
   require('gdt-hist')
-  require('gdt-plot')
+  lazy_require('gdt-plot', gdt, {'plot', 'lineplot', 'barplot', 'boxplot', 'xyline', 'reduce'})
 end
 require('gdt-lm')
 require('gdt-interp')
@@ -96,6 +96,12 @@ local function template_error(code, filename, err)
 end
 
 local function load(filename, defs)
+   -- templates without definitions may be found already expanded and
+   -- compiled in the bytecode bundle
+   local bundle = package.loaded['bytecode-bundle']
+   if bundle and next(defs) == nil and bundle.templates[filename] then
+      return assert(loadstring(bundle.templates[filename]))()
+   end
    local code = process(filename, defs)
    local f, err = loadstring(code, filename)
    if not f then template_error(code, filename, err) end
@@ -16,6 +16,54 @@ local default_spec = {
    ITERATIONS = 5,
 }
 
+-- Lua code run by each parallel worker. The worker loads its own copy
+-- of the VEGAS template, samples a slice of the boxes using the grid of
+-- the main state and stores the results in the output buffer.
+local worker_code = [[
+local k, nw, spec, fcode, state_addr, out_addr, seed = ...
+local ffi = require 'ffi'
+local worker = require 'parallel-worker'
+local state = worker.cached('vegas:' .. spec, function()
+   return require('template').load('vegas-defs', loadstring('return ' .. spec)())
+end)
+local f = worker.load_function(fcode)
+local r = worker.rng((seed + k * 7919) % 4294967296)
+local get = r.get
+local rget = function() return get(r) end
+local buf, out = ffi.cast('double *', state_addr), ffi.cast('double *', out_addr)
+state.sample_slice(f, rget, buf, out + (k - 1) * state.slice_size, k, nw)
+]]
+
+local function spec_string(template_spec)
+  local keys, items = {}, {}
+  for k in pairs(template_spec) do keys[#keys+1] = k end
+  table.sort(keys)
+  for i, k in ipairs(keys) do
+    items[i] = string.format('%s=%.17g', k, template_spec[k])
+  end
+  return '{' .. table.concat(items, ',') .. '}'
+end
+
+-- Return a function that samples all the boxes using "nw" parallel
+-- workers. Each worker has its own random number generator whose seed
+-- depends only on the seed given, on the worker index and on the pass
+-- so that the results are reproducible for a given number of workers.
+local function parallel_sampler(state, template_spec, f, a, nw, seed)
+  local spec = spec_string(template_spec)
+  local fcode = parallel.dump(f)
+  local buf = ffi.new('double[?]', state.state_size)
+  local out = ffi.new('double[?]', state.slice_size * nw)
+  local buf_addr, out_addr = parallel.address(buf), parallel.address(out)
+  local pass = 0
+  return function()
+    state.export_state(a, buf)
+    pass = pass + 1
+    local pass_seed = (seed + pass * 1000003) % 4294967296
+    parallel.run(worker_code, nw, spec, fcode, buf_addr, out_addr, pass_seed)
+    return state.merge_slices(out, nw)
+  end
+end
+
 local function getintegrator(state,template_spec)
   --- perform VEGAS Monte Carlo integration of f
   -- @param f function of an N-dimensional vector (/table/ffi-array...)
@@ -27,21 +75,30 @@ local function getintegrator(state,template_spec)
   --   chidev deviation tolerance for the integrals' chi^2 value
   --         integration will be repeated until chi^2 < chidev
   --   warmup number of calls for warmup phase (default 1e4)
+  --   threads number of parallel workers (default 1), f should
+  --         not have upvalues in this case
+  --   seed seed of the workers' random number generators
   return function(f,a,b,calls,options)
     local r = options and options.r
     local rget = r and (function() return r:get() end) or math.random
     local chidev = options and options.chidev or 0.5
+    local nw = parallel.threads(options and options.threads)
     local N = template_spec.N
     calls = calls or 1e4*N
     local a_work = a
-    if type(a)=="table" then
+    if type(a)=="table" or nw > 1 then
       a_work = ffi.new("double[?]",N+1)
       for i=1,N do a_work[i] = a[i] end
     end
+    local sample_all
+    if nw > 1 then
+      local seed = options.seed or (r and r:getint(2147483647)) or 0
+      sample_all = parallel_sampler(state, template_spec, f, a_work, nw, seed)
+    end
     state.init(a_work, b) -- initialise
     state.clear_stage1() -- clear results
     state.rebin_stage2(options and options.warmup or 1e4) -- intialise grid
-    state.integrate(f,a_work,rget) -- warmup
+    state.integrate(f,a_work,rget,sample_all) -- warmup
     local nruns = 0
     local result,sigma
     -- full integration:
@@ -53,7 +110,7 @@ local function getintegrator(state,template_spec)
         state.clear_stage1()
         -- rebin grid for (modified) number of calls
         state.rebin_stage2(calls/template_spec.ITERATIONS)
-        result,sigma = state.integrate(f,a_work,rget)
+        result,sigma = state.integrate(f,a_work,rget,sample_all)
         nruns = nruns+1
       until abs(state.chisq() - 1) < chidev
       return result,sigma,nruns
@@ -0,0 +1,158 @@
+
+-- workspace.lua
+--
+-- Copyright (C) 2009-2022 Francesco Abbate
+--
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 3 of the License, or (at
+-- your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+-- General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+--
+
+-- Pool of the GSL workspaces used by the linear algebra, eigensystem and
+-- linear fit routines. A workspace is taken from the pool with "acquire"
+-- and given back with "release" once the computation is done so that it
+-- can be reused by the next call with the same kind and sizes. The idle
+-- workspaces are freed, least recently used first, when their number or
+-- their memory exceed the limits.
+--
+-- The workspaces are registered with ffi.gc so that they are freed by the
+-- garbage collector if they are not released because of an error. For
+-- this reason the records of the acquired workspaces are indexed by
+-- address and do not reference the workspace.
+
+local ffi = require 'ffi'
+local gsl = require 'gsl'
+
+local M = {}
+
+local kinds = {}
+
+-- idle workspaces, each one as {kind, key, ws, bytes, tick}
+local idle = {}
+-- record of each acquired workspace indexed by its address, the field
+-- of the workspace is false until it is released
+local busy = {}
+
+local tick = 0
+local limit_count, limit_bytes = 32, 64 * 1024 * 1024
+local stats = {hits = 0, misses = 0, evictions = 0, idle = 0, bytes = 0}
+
+local SIZEOF_DOUBLE, SIZEOF_SIZE_T = ffi.sizeof('double'), ffi.sizeof('size_t')
+
+-- Register a kind of workspace. "alloc" and "free" are the GSL functions
+-- to allocate and free the workspace while "bytes" is a function of the
+-- same arguments of "alloc" returning an estimate of the memory used.
+function M.register(name, alloc, free, bytes)
+   kinds[name] = {alloc = alloc, free = free, bytes = bytes}
+end
+
+local function address(ws)
+   return tonumber(ffi.cast('intptr_t', ws))
+end
+
+local function release_memory(entry)
+   local kind = kinds[entry[1]]
+   ffi.gc(entry[3], nil)
+   kind.free(entry[3])
+   stats.idle = stats.idle - 1
+   stats.bytes = stats.bytes - entry[4]
+end
+
+local function evict(count, bytes)
+   while #idle > 0 and (stats.idle > count or stats.bytes > bytes) do
+      local lru, lru_tick = 1, idle[1][5]
+      for k = 2, #idle do
+         if idle[k][5] < lru_tick then lru, lru_tick = k, idle[k][5] end
+      end
+      release_memory(table.remove(idle, lru))
+      stats.evictions = stats.evictions + 1
+   end
+end
+
+-- Return a workspace of the given kind. The arguments, typically the
+-- sizes of the problem, are passed to the GSL allocation function.
+function M.acquire(name, a, b)
+   a, b = tonumber(a), tonumber(b)
+   local key = b and (a .. 'x' .. b) or a
+   for k = #idle, 1, -1 do
+      local entry = idle[k]
+      if entry[1] == name and entry[2] == key then
+         table.remove(idle, k)
+         stats.idle = stats.idle - 1
+         stats.bytes = stats.bytes - entry[4]
+         stats.hits = stats.hits + 1
+         local ws = entry[3]
+         entry[3] = false
+         busy[address(ws)] = entry
+         return ws
+      end
+   end
+   local kind = kinds[name]
+   local ws
+   if b then ws = kind.alloc(a, b) else ws = kind.alloc(a) end
+   if ws == nil then error('cannot allocate workspace: ' .. name, 2) end
+   local addr = address(ws)
+   ws = ffi.gc(ws, function(ws)
+      busy[addr] = nil
+      kind.free(ws)
+   end)
+   stats.misses = stats.misses + 1
+   busy[addr] = {name, key, false, kind.bytes(a, b), 0}
+   return ws
+end
+
+-- Give back to the pool a workspace obtained with "acquire".
+function M.release(ws)
+   local addr = address(ws)
+   local entry = busy[addr]
+   if not entry then error('workspace not acquired from the pool', 2) end
+   busy[addr] = nil
+   tick = tick + 1
+   entry[3], entry[5] = ws, tick
+   idle[#idle+1] = entry
+   stats.idle = stats.idle + 1
+   stats.bytes = stats.bytes + entry[4]
+   evict(limit_count, limit_bytes)
+end
+
+-- Free all the idle workspaces.
+function M.clear()
+   evict(0, -1)
+end
+
+-- Set the maximum number of idle workspaces and the maximum memory, in
+-- bytes, they can use. A nil argument leaves the limit unchanged.
+function M.set_limit(count, bytes)
+   limit_count = count or limit_count
+   limit_bytes = bytes or limit_bytes
+   evict(limit_count, limit_bytes)
+end
+
+-- Return a table with the number of idle workspaces and their memory and
+-- the number of hits, misses and evictions.
+function M.stats()
+   return {idle = stats.idle, bytes = stats.bytes, hits = stats.hits,
+           misses = stats.misses, evictions = stats.evictions,
+           limit_count = limit_count, limit_bytes = limit_bytes}
+end
+
+M.register('permutation', gsl.gsl_permutation_alloc, gsl.gsl_permutation_free,
+           function(n) return n * SIZEOF_SIZE_T end)
+M.register('vector', gsl.gsl_vector_alloc, gsl.gsl_vector_free,
+           function(n) return n * SIZEOF_DOUBLE end)
+M.register('vector_complex', gsl.gsl_vector_complex_alloc, gsl.gsl_vector_complex_free,
+           function(n) return 2 * n * SIZEOF_DOUBLE end)
+M.register('multifit_linear', gsl.gsl_multifit_linear_alloc, gsl.gsl_multifit_linear_free,
+           function(n, p) return (n * p + 2 * p * p + n + 3 * p) * SIZEOF_DOUBLE end)
+
+return M
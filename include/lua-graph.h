@@ -20,6 +20,11 @@ extern pthread_mutex_t agg_mutex[1];
 #define AGG_LOCK() pthread_mutex_lock (agg_mutex);
 #define AGG_UNLOCK() pthread_mutex_unlock (agg_mutex);
 
+/* Used through the FFI to write the buffers of the graphical objects
+   that the windows may be drawing. */
+extern void gsl_shell_graph_lock (void);
+extern void gsl_shell_graph_unlock (void);
+
 __END_DECLS
 
 #endif
@@ -0,0 +1,14 @@
+#ifndef LUA_PARALLEL_H
+#define LUA_PARALLEL_H
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+#include <lua.h>
+
+extern int luaopen_parallel (lua_State *L);
+
+__END_DECLS
+
+#endif
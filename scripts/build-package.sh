@@ -2,7 +2,7 @@
 
 set -o errexit
 
-blas_option=
+blas_option="-Dblas=internal"
 pargs=()
 cblastag="-gslcblas"
 add_name=""
@@ -84,6 +84,7 @@ mkdir -p "$bindir" "$datadir"
 cp "$builddir/src/console/gsl-shell$ext" "$bindir"
 cp "$builddir/src/fox-gui/gsl-shell-gui$ext" "$bindir"
 cp -r data/. "$datadir"
+"$bindir/gsl-shell$ext" scripts/bytecode-bundle.lua "$datadir"
 cp resources/gsl-shell.desktop resources/gsl-shell.svg "$rundir"
 
 $strip "$bindir/gsl-shell$ext" "$bindir/gsl-shell-gui$ext"
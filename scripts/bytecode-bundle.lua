@@ -0,0 +1,96 @@
+-- bytecode-bundle.lua
+--
+-- Precompile the Lua modules of GSL Shell into a single LuaJIT bytecode
+-- bundle loaded by start.lua in place of the source files.
+--
+-- Usage: gsl-shell scripts/bytecode-bundle.lua <datadir> [<output>]
+--
+-- The script should be run using the gsl-shell executable itself because
+-- the modules use the short function syntax not supported by a standard
+-- LuaJIT. The templates that are loaded without definitions are stored
+-- already expanded. The output file defaults to <datadir>/gsl-shell.luab.
+
+local template = require 'template'
+
+local datadir = arg[1]
+if not datadir then
+   io.stderr:write('usage: gsl-shell bytecode-bundle.lua <datadir> [<output>]\n')
+   os.exit(1)
+end
+local output = arg[2] or (datadir .. '/gsl-shell.luab')
+
+-- modules directories relative to datadir, the root first
+local module_dirs = {'', 'help', 'pre3d', 'demos'}
+
+-- templates loaded with an empty definitions table
+local static_templates = {'rnd-defs', 'sf-defs'}
+
+-- files that are not loaded using require
+local excluded = {['start'] = true}
+
+local function read_file(filename)
+   local f = assert(io.open(filename, 'rb'))
+   local content = f:read('*a')
+   f:close()
+   return content
+end
+
+local function compile(source, chunkname)
+   local f, err = loadstring(source, chunkname)
+   if not f then error(err) end
+   return string.dump(f)
+end
+
+local function list_lua_files(dir)
+   local ls = {}
+   for _, filename in ipairs(assert(filesystem.list_dir(dir))) do
+      local name = filename:match('^(.+)%.lua$')
+      if name then ls[#ls+1] = name end
+   end
+   table.sort(ls)
+   return ls
+end
+
+local modules, templates = {}, {}
+local count = 0
+
+for _, subdir in ipairs(module_dirs) do
+   local dir = subdir == '' and datadir or (datadir .. '/' .. subdir)
+   for _, name in ipairs(list_lua_files(dir)) do
+      local modname = subdir == '' and name or (subdir .. '.' .. name)
+      if not excluded[modname] then
+         local relpath = subdir == '' and name or (subdir .. '/' .. name)
+         local source = read_file(dir .. '/' .. name .. '.lua')
+         modules[modname] = compile(source, '@' .. relpath .. '.lua')
+         count = count + 1
+      end
+   end
+end
+
+for _, name in ipairs(static_templates) do
+   local code = template.process(name, {})
+   templates[name] = compile(code, '@' .. name .. '.lua.in')
+   count = count + 1
+end
+
+-- The bundle is itself a bytecode chunk that returns the tables of the
+-- compiled modules and templates as strings.
+local function add_table(code, tname, t)
+   local keys = {}
+   for k in pairs(t) do keys[#keys+1] = k end
+   table.sort(keys)
+   for _, k in ipairs(keys) do
+      code[#code+1] = string.format('%s[%q] = %q\n', tname, k, t[k])
+   end
+end
+
+local code = {'local M, T = {}, {}\n'}
+add_table(code, 'M', modules)
+add_table(code, 'T', templates)
+code[#code+1] = 'return M, T\n'
+
+local f = assert(io.open(output, 'wb'))
+f:write(compile(table.concat(code), '=gsl-shell.luab'))
+f:close()
+
+print(string.format('%s: %d chunks compiled', output, count))
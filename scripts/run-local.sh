@@ -13,6 +13,9 @@ while [[ "$#" -gt 0 ]]; do
     -unix)
     use_unix=yes
     ;;
+    -bundle)
+    use_bundle=yes
+    ;;
     -*)
     echo "error: unknown option \"$1\""
     exit 1
@@ -52,6 +55,9 @@ mkdir -p "$bindir" "$datadir"
 cp "$builddir/src/console/gsl-shell$ext" "$bindir"
 cp "$builddir/src/fox-gui/gsl-shell-gui$ext" "$bindir"
 cp -r data/. "$datadir"
+if [ -n "${use_bundle+x}" ]; then
+  "$bindir/gsl-shell$ext" scripts/bytecode-bundle.lua "$datadir"
+fi
 
 "$bindir/$exe_name"
 
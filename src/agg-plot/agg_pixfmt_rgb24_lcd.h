@@ -32,6 +32,7 @@
 #include <stdio.h>
 
 #include "agg_basics.h"
+#include "agg_array.h"
 #include "agg_color_rgba.h"
 #include "agg_rendering_buffer.h"
 
@@ -56,30 +57,51 @@ public:
             unsigned t = round(tert   * b);
             unsigned p = b - (2*s + 2*t);
 
-            m_data[3*i + 1] = s; /* secondary */
-            m_data[3*i + 2] = t; /* tertiary */
-            m_data[3*i    ] = p; /* primary */
+            m_secondary[i] = s;
+            m_tertiary[i]  = t;
+            m_primary[i]   = p;
         }
     }
 
-    unsigned convolution(const int8u* covers, int i0, int i_min, int i_max) const
+    // Filter the covers around the given one. Two covers should be
+    // readable on each side, see lcd_padded_covers.
+    unsigned convolution(const int8u* covers) const
     {
-        unsigned sum = 0;
-        int k_min = (i0 >= i_min + 2 ? -2 : i_min - i0);
-        int k_max = (i0 <= i_max - 2 ?  2 : i_max - i0);
-        for (int k = k_min; k <= k_max; k++)
-        {
-            /* select the primary, secondary or tertiary channel */
-            int channel = abs(k) % 3;
-            int8u c = covers[i0 + k];
-            sum += m_data[3*c + channel];
-        }
-
+        unsigned sum = m_tertiary[covers[-2]] + m_secondary[covers[-1]] +
+                       m_primary[covers[0]] +
+                       m_secondary[covers[1]] + m_tertiary[covers[2]];
         return (sum + 128) >> 8;
     }
 
 private:
-    unsigned short m_data[256*3];
+    unsigned short m_primary[256];
+    unsigned short m_secondary[256];
+    unsigned short m_tertiary[256];
+};
+
+//=======================================================lcd_padded_covers
+// Copy of the covers of a span with zero covers added on each side so
+// that the filter does not need to check the bounds of the span. The
+// filter is applied up to two subpixels beyond the span so it reads up
+// to four covers beyond it. A zero cover gives no contribution.
+class lcd_padded_covers
+{
+    enum { pad = 4 };
+
+public:
+    const int8u* set(const int8u* covers, unsigned len)
+    {
+        if (m_covers.size() < len + 2 * pad)
+            m_covers.resize(len + 2 * pad);
+        int8u* p = m_covers.data();
+        memset(p, 0, pad);
+        memcpy(p + pad, covers, len);
+        memset(p + pad + len, 0, pad);
+        return p + pad;
+    }
+
+private:
+    pod_array<int8u> m_covers;
 };
 
 
@@ -136,30 +158,53 @@ public:
                            const color_type& c,
                            const int8u* covers)
     {
-        unsigned rowlen = width();
+        int rowlen = width();
         int cx = (x - 2 >= 0 ? -2 : -x);
-        int cx_max = (len + 2 <= rowlen ? len + 1 : rowlen - 1);
+        int cx_max = (x + int(len) + 2 <= rowlen ? len + 1 : rowlen - 1 - x);
 
         int i = (x + cx) % 3;
 
+        const int8u* pcovers = m_covers.set(covers, len);
+        const unsigned ca = c.a + 1;
         int8u rgb[3] = { c.r, c.g, c.b };
         int8u* p = m_rbuf->row_ptr(y) + (x + cx);
 
         for (/* */; cx <= cx_max; cx++)
         {
-            unsigned c_conv = m_lut->convolution(covers, cx, 0, len - 1);
-            unsigned alpha = (c_conv + 1) * (c.a + 1);
+            unsigned c_conv = m_lut->convolution(pcovers + cx);
+            unsigned alpha = (c_conv + 1) * ca;
             unsigned dst_col = rgb[i], src_col = (*p);
             *p = (int8u)((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
 
             p ++;
-            i = (i + 1) % 3;
+            if (++i == 3) i = 0;
+        }
+    }
+
+    // Blend a span of whole pixels, each one with its own color, without
+    // the subpixel filtering. The position and the length are in pixels.
+    void blend_color_pixels(int x, int y, unsigned len, const color_type* colors)
+    {
+        int8u* p = m_rbuf->row_ptr(y) + 3 * x;
+        for (unsigned k = 0; k < len; k++, p += 3)
+        {
+            const color_type& c = colors[k];
+            if (c.a == 0)
+                continue;
+            unsigned alpha = (c.a + 1) << 8;
+            int8u rgb[3] = { c.r, c.g, c.b };
+            for (int i = 0; i < 3; i++)
+            {
+                unsigned dst_col = rgb[i], src_col = p[i];
+                p[i] = (int8u)((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+            }
         }
     }
 
 private:
     rendering_buffer* m_rbuf;
     const lcd_distribution_lut* m_lut;
+    lcd_padded_covers m_covers;
 };
 
 template <class Gamma>
@@ -207,29 +252,61 @@ public:
     }
 
     //--------------------------------------------------------------------
+    // The gamma corrected color is computed once for the span. Where the
+    // filtered cover is full and the color is opaque the result does not
+    // depend on the pixel so it is also computed once.
     void blend_solid_hspan(int x, int y,
                            unsigned len,
                            const color_type& c,
                            const int8u* covers)
     {
-        unsigned rowlen = width();
+        int rowlen = width();
         int cx = (x - 2 >= 0 ? -2 : -x);
-        int cx_max = (len + 2 <= rowlen ? len + 1 : rowlen - 1);
+        int cx_max = (x + int(len) + 2 <= rowlen ? len + 1 : rowlen - 1 - x);
 
         int i = (x + cx) % 3;
 
-        int8u rgb[3] = { c.r, c.g, c.b };
+        const int8u* pcovers = m_covers.set(covers, len);
+        const unsigned ca = c.a + 1;
+        const unsigned full_cover = (c.a == 255 ? 255 : 256);
+        unsigned rgb[3] = { m_gamma.dir(c.r), m_gamma.dir(c.g), m_gamma.dir(c.b) };
+        int8u rgb_opaque[3] = { m_gamma.inv(rgb[0]), m_gamma.inv(rgb[1]), m_gamma.inv(rgb[2]) };
         int8u* p = m_rbuf->row_ptr(y) + (x + cx);
 
         for (/* */; cx <= cx_max; cx++)
         {
-            unsigned c_conv = m_lut->convolution(covers, cx, 0, len - 1);
-            unsigned alpha = (c_conv + 1) * (c.a + 1);
-            unsigned dst_col = m_gamma.dir(rgb[i]), src_col = m_gamma.dir(*p);
-            *p = m_gamma.inv((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+            unsigned c_conv = m_lut->convolution(pcovers + cx);
+            if (c_conv == full_cover)
+            {
+                *p = rgb_opaque[i];
+            }
+            else
+            {
+                unsigned alpha = (c_conv + 1) * ca;
+                unsigned dst_col = rgb[i], src_col = m_gamma.dir(*p);
+                *p = m_gamma.inv((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+            }
 
             p ++;
-            i = (i + 1) % 3;
+            if (++i == 3) i = 0;
+        }
+    }
+
+    void blend_color_pixels(int x, int y, unsigned len, const color_type* colors)
+    {
+        int8u* p = m_rbuf->row_ptr(y) + 3 * x;
+        for (unsigned k = 0; k < len; k++, p += 3)
+        {
+            const color_type& c = colors[k];
+            if (c.a == 0)
+                continue;
+            unsigned alpha = (c.a + 1) << 8;
+            int8u rgb[3] = { c.r, c.g, c.b };
+            for (int i = 0; i < 3; i++)
+            {
+                unsigned dst_col = m_gamma.dir(rgb[i]), src_col = m_gamma.dir(p[i]);
+                p[i] = m_gamma.inv((((dst_col - src_col) * alpha) + (src_col << 16)) >> 16);
+            }
         }
     }
 
@@ -237,6 +314,7 @@ private:
     rendering_buffer* m_rbuf;
     const lcd_distribution_lut* m_lut;
     const Gamma& m_gamma;
+    lcd_padded_covers m_covers;
 };
 
 
@@ -7,11 +7,68 @@ extern "C" {
 #include "bitmap-plot.h"
 #include "lua-cpp-utils.h"
 #include "lua-plot-cpp.h"
+#include "lua-graph.h"
 #include "gs-types.h"
 #include "canvas.h"
 #include "colors.h"
 #include "agg-pixfmt-config.h"
 #include "platform_support_ext.h"
+#include "image_writer.h"
+
+#include "util/agg_color_conv_rgb8.h"
+
+// Rows of a rendering buffer given to the image encoders. The rows in
+// rgb24 format are read directly from the buffer.
+class rbuf_image_source : public image_source {
+public:
+    rbuf_image_source(const agg::rendering_buffer& rbuf, agg::pix_format_e fmt):
+        m_rbuf(rbuf), m_format(fmt)
+    { }
+
+    virtual unsigned width() const { return m_rbuf.width(); }
+    virtual unsigned height() const { return m_rbuf.height(); }
+
+    virtual const unsigned char* row(unsigned y, unsigned char* tmp) const
+    {
+        const unsigned w = m_rbuf.width(), h = m_rbuf.height();
+        const unsigned char* src = m_rbuf.row_ptr(gslshell::flip_y ? h - 1 - y : y);
+        switch (m_format)
+        {
+        case agg::pix_format_bgr24:
+            agg::color_conv_row(tmp, src, w, agg::color_conv_bgr24_to_rgb24());
+            return tmp;
+        case agg::pix_format_rgba32:
+            agg::color_conv_row(tmp, src, w, agg::color_conv_rgba32_to_rgb24());
+            return tmp;
+        case agg::pix_format_bgra32:
+            agg::color_conv_row(tmp, src, w, agg::color_conv_bgra32_to_rgb24());
+            return tmp;
+        default:
+            return src;
+        }
+    }
+
+private:
+    const agg::rendering_buffer& m_rbuf;
+    agg::pix_format_e m_format;
+};
+
+// Save the image in PNG or QOI format, according to the extension of
+// the filename. The rows are encoded directly from the rendering buffer.
+static bool
+save_image_encoded (const agg::rendering_buffer& rbuf, const char *fn,
+                    image_format_e format)
+{
+    FILE *f = fopen (fn, "wb");
+    if (!f)
+        return false;
+
+    rbuf_image_source src(rbuf, gslshell::pixel_format);
+    bool success = (format == image_format_png ? write_png (f, src) : write_qoi (f, src));
+    if (fclose (f) != 0)
+        success = false;
+    return success;
+}
 
 void
 bitmap_save_image_cpp (sg_plot *p, const char *fn, unsigned w, unsigned h,
@@ -36,9 +93,17 @@ bitmap_save_image_cpp (sg_plot *p, const char *fn, unsigned w, unsigned h,
     agg::rect_base<int> r = rect_of_slot_matrix<int>(mtx);
     can.clear_box(r);
 
-    p->draw(can, mtx, NULL);
-
-    bool success = platform_support_ext::save_image_file (rbuf_tmp, fn, gslshell::pixel_format);
+    // the plot keeps the image of its layers while drawing
+    AGG_LOCK();
+    p->draw(can, mtx, NULL, true);
+    AGG_UNLOCK();
+
+    image_format_e format = image_format_from_filename (fn);
+    bool success;
+    if (format == image_format_native)
+        success = platform_support_ext::save_image_file (rbuf_tmp, fn, gslshell::pixel_format);
+    else
+        success = save_image_encoded (rbuf_tmp, fn, format);
 
     if (! success)
         st.error("cannot save image file", "plot save");
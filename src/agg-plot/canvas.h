@@ -4,9 +4,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
 
 #include "pixel_fmt.h"
 #include "sg_object.h"
+#include "render_stats.h"
 
 #include "agg_basics.h"
 #include "agg_rendering_buffer.h"
@@ -15,6 +17,96 @@
 #include "agg_renderer_scanline.h"
 #include "agg_trans_viewport.h"
 #include "agg_conv_stroke.h"
+#include "agg_array.h"
+
+// Copy of the pixels of a rectangular area of a rendering buffer with
+// three bytes per pixel. The coordinates of the area are inclusive like
+// the ones of the clip box.
+class canvas_image {
+public:
+    enum { pixel_width = 3 };
+
+    canvas_image(): m_rect(0, 0, -1, -1) { }
+
+    void save(agg::rendering_buffer& rbuf, const agg::rect_i& r)
+    {
+        m_rect = r;
+        if (!m_rect.clip(agg::rect_i(0, 0, int(rbuf.width()) - 1, int(rbuf.height()) - 1)))
+        {
+            m_rect = agg::rect_i(0, 0, -1, -1);
+            return;
+        }
+        const unsigned row_len = row_length();
+        m_pixels.resize(row_len * (m_rect.y2 - m_rect.y1 + 1));
+        for (int y = m_rect.y1; y <= m_rect.y2; y++)
+        {
+            agg::int8u* dst = m_pixels.data() + row_len * (y - m_rect.y1);
+            memcpy(dst, rbuf.row_ptr(y) + pixel_width * m_rect.x1, row_len);
+        }
+    }
+
+    void restore(agg::rendering_buffer& rbuf) const
+    {
+        const unsigned row_len = row_length();
+        for (int y = m_rect.y1; y <= m_rect.y2; y++)
+        {
+            const agg::int8u* src = m_pixels.data() + row_len * (y - m_rect.y1);
+            memcpy(rbuf.row_ptr(y) + pixel_width * m_rect.x1, src, row_len);
+        }
+    }
+
+private:
+    unsigned row_length() const {
+        return pixel_width * unsigned(m_rect.x2 - m_rect.x1 + 1);
+    }
+
+    agg::pod_array<agg::int8u> m_pixels;
+    agg::rect_i m_rect;
+};
+
+// Same as agg::render_scanlines but return the number of scanlines
+// rendered.
+template <class Rasterizer, class Scanline, class Renderer>
+unsigned render_scanlines_counted(Rasterizer& ras, Scanline& sl, Renderer& ren)
+{
+    unsigned n = 0;
+    if (ras.rewind_scanlines())
+    {
+        sl.reset(ras.min_x(), ras.max_x());
+        ren.prepare();
+        while (ras.sweep_scanline(sl))
+        {
+            ren.render(sl);
+            n++;
+        }
+    }
+    return n;
+}
+
+// Vertex source adaptor that counts the vertices of a path.
+template <class VertexSource>
+class conv_count_vertices {
+public:
+    conv_count_vertices(VertexSource& vs): m_source(&vs), m_count(0) { }
+
+    void rewind(unsigned path_id) {
+        m_source->rewind(path_id);
+    }
+
+    unsigned vertex(double* x, double* y)
+    {
+        unsigned cmd = m_source->vertex(x, y);
+        if (agg::is_vertex(cmd))
+            m_count++;
+        return cmd;
+    }
+
+    unsigned count() const { return m_count; }
+
+private:
+    VertexSource* m_source;
+    unsigned m_count;
+};
 
 template <class Pixel>
 class renderer_gray_aa
@@ -67,10 +159,23 @@ public:
         m_ren_base.reset_clipping(true);
     }
 
+    agg::rect_i pixel_clip_box() const {
+        return m_ren_base.clip_box();
+    }
+
+    void blend_image(const sg_image& img)
+    {
+        for (unsigned j = 0; j < img.height; j++)
+        {
+            const agg::rgba8* row = img.pixels + j * img.width;
+            m_ren_base.blend_color_hspan(img.x, img.y + j, img.width, row, 0, agg::cover_full);
+        }
+    }
+
     template <class Rasterizer, class Scanline>
-    void render_scanlines(Rasterizer& ras, Scanline& sl)
+    unsigned render_scanlines(Rasterizer& ras, Scanline& sl)
     {
-        agg::render_scanlines(ras, sl, m_ren_solid);
+        return render_scanlines_counted(ras, sl, m_ren_solid);
     }
 private:
     Pixel m_pixbuf;
@@ -131,6 +236,30 @@ public:
         m_ren_base.reset_clipping(true);
     }
 
+    agg::rect_i pixel_clip_box() const {
+        const agg::rect_i& r = m_ren_base.clip_box();
+        return agg::rect_i(r.x1 / subpixel_scale, r.y1, (r.x2 + 1) / subpixel_scale - 1, r.y2);
+    }
+
+    // The pixels of the image are blended as a whole, without the
+    // subpixel filtering.
+    void blend_image(const sg_image& img)
+    {
+        const agg::rect_i clip = pixel_clip_box();
+        const int x1 = (img.x > clip.x1 ? img.x : clip.x1);
+        const int x2 = (img.x + int(img.width) - 1 < clip.x2 ? img.x + int(img.width) - 1 : clip.x2);
+        if (x1 > x2)
+            return;
+        for (unsigned j = 0; j < img.height; j++)
+        {
+            const int y = img.y + j;
+            if (y < clip.y1 || y > clip.y2)
+                continue;
+            const agg::rgba8* row = img.pixels + j * img.width + (x1 - img.x);
+            m_pixbuf.blend_color_pixels(x1, y, x2 - x1 + 1, row);
+        }
+    }
+
     template <class Rasterizer, class VertexSource>
     static void add_path(Rasterizer& ras, VertexSource& vs)
     {
@@ -144,9 +273,9 @@ public:
     }
 
     template <class Rasterizer, class Scanline>
-    void render_scanlines(Rasterizer& ras, Scanline& sl)
+    unsigned render_scanlines(Rasterizer& ras, Scanline& sl)
     {
-        agg::render_scanlines(ras, sl, m_ren_solid);
+        return render_scanlines_counted(ras, sl, m_ren_solid);
     }
 
 private:
@@ -169,25 +298,66 @@ class canvas_gen : public Renderer {
 public:
     canvas_gen(agg::rendering_buffer& ren_buf, double width, double height,
                agg::rgba8 bgcol):
-        Renderer(ren_buf, bgcol), ras(), sl()
+        Renderer(ren_buf, bgcol), ras(), sl(), m_rbuf(ren_buf), m_stats(0)
     { }
 
+    // Set the stats where the vertices and the scanlines rendered are
+    // counted. A null pointer disables the counting.
+    void stats(render_stats* s) { m_stats = s; }
+
+    // Both renderers use a buffer with RGB pixels of three bytes so the
+    // pixels can be copied directly.
+    bool save_area(const agg::rect_i& r, canvas_image& img)
+    {
+        img.save(m_rbuf, r);
+        return true;
+    }
+
+    bool restore_area(const canvas_image& img)
+    {
+        img.restore(m_rbuf);
+        return true;
+    }
+
     void draw(sg_object& vs, agg::rgba8 c)
     {
-        this->add_path(this->ras, vs);
+        const sg_image* img = vs.rasterize(this->pixel_clip_box(), c);
+        if (img)
+        {
+            this->blend_image(*img);
+            return;
+        }
+        conv_count_vertices<sg_object> path(vs);
+        this->add_path(this->ras, path);
         this->color(c);
-        this->render_scanlines(this->ras, this->sl);
+        unsigned n = this->render_scanlines(this->ras, this->sl);
+        count(path.count(), n);
     }
 
     void draw_outline(sg_object& vs, agg::rgba8 c)
     {
-        agg::conv_stroke<sg_object> line(vs);
+        conv_count_vertices<sg_object> path(vs);
+        agg::conv_stroke<conv_count_vertices<sg_object> > line(path);
         line.width(line_width / 100.0);
         line.line_cap(agg::round_cap);
         this->add_path(this->ras, line);
         this->color(c);
-        this->render_scanlines(this->ras, this->sl);
+        unsigned n = this->render_scanlines(this->ras, this->sl);
+        count(path.count(), n);
     }
+
+private:
+    void count(unsigned vertices, unsigned scanlines)
+    {
+        if (m_stats)
+        {
+            m_stats->add_vertices(vertices);
+            m_stats->add_scanlines(scanlines);
+        }
+    }
+
+    agg::rendering_buffer& m_rbuf;
+    render_stats* m_stats;
 };
 
 struct virtual_canvas {
@@ -197,6 +367,11 @@ struct virtual_canvas {
     virtual void clip_box(const agg::rect_base<int>& clip) = 0;
     virtual void reset_clipping() = 0;
 
+    // Copy the pixels of an area to an image and back. Return false if
+    // the canvas does not have pixels, like the SVG canvas.
+    virtual bool save_area(const agg::rect_i& r, canvas_image& img) = 0;
+    virtual bool restore_area(const canvas_image& img) = 0;
+
     virtual ~virtual_canvas() { }
 };
 
@@ -0,0 +1,210 @@
+
+/* contour.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+
+#include "contour.h"
+
+// Maximum number of function evaluations to refine a crossing point.
+static const int refine_max_iter = 10;
+
+contour_grid::contour_grid(double x1, double y1, double x2, double y2, unsigned nx, unsigned ny):
+    m_x1(x1), m_y1(y1), m_dx((x2 - x1) / nx), m_dy((y2 - y1) / ny),
+    m_nx(nx), m_ny(ny), m_hedges((ny + 1) * nx), m_vedges(ny * (nx + 1)),
+    m_z((nx + 1) * (ny + 1)), m_next(m_hedges + m_vedges + (nx + 1) * (ny + 1))
+{
+    for (unsigned k = 0; k < m_z.size(); k++)
+        m_z[k] = 0.0;
+}
+
+void contour_grid::border(contour_loops& loops) const
+{
+    const unsigned nx = m_nx, ny = m_ny;
+    const double x2 = m_x1 + nx * m_dx, y2 = m_y1 + ny * m_dy;
+    for (unsigned j = 0; j < nx; j++)
+        border_point(loops, m_x1 + j * m_dx, m_y1);
+    for (unsigned i = 0; i < ny; i++)
+        border_point(loops, x2, m_y1 + i * m_dy);
+    for (unsigned j = nx; j > 0; j--)
+        border_point(loops, m_x1 + j * m_dx, y2);
+    for (unsigned i = ny; i > 0; i--)
+        border_point(loops, m_x1, m_y1 + i * m_dy);
+    loops.ends.add(loops.points.size());
+}
+
+// Edge of the border going from the node a to the node b in
+// counterclockwise order.
+void contour_grid::border_edge(unsigned ia, unsigned ja, unsigned ib, unsigned jb, int edge, double level)
+{
+    const bool a_in = (m_z[ia * (m_nx + 1) + ja] >= level);
+    const bool b_in = (m_z[ib * (m_nx + 1) + jb] >= level);
+    if (a_in && b_in)
+        m_next[node(ia, ja)] = node(ib, jb);
+    else if (a_in)
+        m_next[node(ia, ja)] = edge;
+    else if (b_in)
+        m_next[edge] = node(ib, jb);
+}
+
+bool contour_grid::point_coords(int id, double level, contour_function* f, double eps, double* x, double* y) const
+{
+    const unsigned nodes_offset = m_hedges + m_vedges;
+    if (!is_crossing(id)) {
+        const unsigned k = id - nodes_offset;
+        *x = m_x1 + (k % (m_nx + 1)) * m_dx;
+        *y = m_y1 + (k / (m_nx + 1)) * m_dy;
+        return true;
+    }
+
+    unsigned i, j, di = 0, dj = 0;
+    if (id < int(m_hedges)) {
+        i = id / m_nx;
+        j = id % m_nx;
+        dj = 1;
+    } else {
+        i = (id - m_hedges) / (m_nx + 1);
+        j = (id - m_hedges) % (m_nx + 1);
+        di = 1;
+    }
+
+    const double xa = m_x1 + j * m_dx, ya = m_y1 + i * m_dy;
+    const double sx = dj * m_dx, sy = di * m_dy;
+    double fa = m_z[i * (m_nx + 1) + j] - level;
+    double fb = m_z[(i + di) * (m_nx + 1) + j + dj] - level;
+    double t = (isfinite(fa) && isfinite(fb) ? fa / (fa - fb) : 0.5);
+
+    // Regula falsi with the Illinois modification. The crossing is always
+    // kept between the nodes and the starting interval is the grid edge.
+    if (f && isfinite(fa) && isfinite(fb)) {
+        double ta = 0.0, tb = 1.0;
+        int side = 0;
+        for (int k = 0; k < refine_max_iter; k++) {
+            const double ft = f->eval(xa + t * sx, ya + t * sy);
+            if (ft != ft)
+                return false;
+            const double d = ft - level;
+            if (fabs(d) <= eps)
+                break;
+            if ((d < 0) == (fa < 0)) {
+                ta = t;
+                fa = d;
+                if (side == -1)
+                    fb /= 2;
+                side = -1;
+            } else {
+                tb = t;
+                fb = d;
+                if (side == 1)
+                    fa /= 2;
+                side = 1;
+            }
+            t = (fa * tb - fb * ta) / (fa - fb);
+        }
+    }
+
+    *x = xa + t * sx;
+    *y = ya + t * sy;
+    return true;
+}
+
+bool contour_grid::trace(double level, contour_loops& loops, contour_function* f, double eps)
+{
+    const unsigned nx = m_nx, ny = m_ny, row = nx + 1;
+    const double* z = m_z.data();
+    int* next = m_next.data();
+    const unsigned n_points = m_next.size();
+
+    for (unsigned k = 0; k < n_points; k++)
+        next[k] = no_point;
+
+    // Each cell links the crossings where the region is left, going
+    // counterclockwise along the sides of the cell, to the crossings
+    // where the region is entered. The region is on the left of the
+    // segments.
+    for (unsigned i = 0; i < ny; i++) {
+        for (unsigned j = 0; j < nx; j++) {
+            const double zc[4] = {z[i * row + j], z[i * row + j + 1], z[(i + 1) * row + j + 1], z[(i + 1) * row + j]};
+            const int edges[4] = {hedge(i, j), vedge(i, j + 1), hedge(i + 1, j), vedge(i, j)};
+
+            unsigned mask = 0;
+            for (int k = 0; k < 4; k++) {
+                if (zc[k] >= level)
+                    mask |= (1 << k);
+            }
+            if (mask == 0 || mask == 15)
+                continue;
+
+            // In the saddle cells the exits are linked to the following
+            // entry if the saddle point is inside the region, otherwise to
+            // the preceding one. The value at the saddle point is given by
+            // the bilinear interpolation.
+            int step = 1;
+            if (mask == 5 || mask == 10) {
+                const double den = zc[0] + zc[2] - zc[1] - zc[3];
+                const double zs = (den != 0 ? (zc[0] * zc[2] - zc[1] * zc[3]) / den : (zc[0] + zc[1] + zc[2] + zc[3]) / 4);
+                step = (zs >= level ? 1 : 3);
+            }
+
+            for (int k = 0; k < 4; k++) {
+                const bool exit = (mask & (1 << k)) && !(mask & (1 << ((k + 1) % 4)));
+                if (!exit)
+                    continue;
+                for (int s = 1, e = (k + step) % 4; s < 4; s++, e = (e + step) % 4) {
+                    const bool entry = !(mask & (1 << e)) && (mask & (1 << ((e + 1) % 4)));
+                    if (entry) {
+                        next[edges[k]] = edges[e];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // The border of the grid counterclockwise.
+    for (unsigned j = 0; j < nx; j++)
+        border_edge(0, j, 0, j + 1, hedge(0, j), level);
+    for (unsigned i = 0; i < ny; i++)
+        border_edge(i, nx, i + 1, nx, vedge(i, nx), level);
+    for (unsigned j = nx; j > 0; j--)
+        border_edge(ny, j, ny, j - 1, hedge(ny, j - 1), level);
+    for (unsigned i = ny; i > 0; i--)
+        border_edge(i, 0, i - 1, 0, vedge(i - 1, 0), level);
+
+    // The links are followed to assemble the loops. Each point belongs
+    // to one loop only and the links are removed once used.
+    for (unsigned start = 0; start < n_points; start++) {
+        if (next[start] == no_point)
+            continue;
+        int id = start;
+        do {
+            const int id_next = next[id];
+            contour_point p;
+            if (!point_coords(id, level, f, eps, &p.x, &p.y))
+                return false;
+            p.line = (id_next != no_point && is_crossing(id) && is_crossing(id_next));
+            loops.points.add(p);
+            next[id] = no_point;
+            id = id_next;
+        } while (id != int(start) && id != no_point);
+        loops.ends.add(loops.points.size());
+    }
+
+    return true;
+}
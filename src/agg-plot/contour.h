@@ -0,0 +1,90 @@
+#ifndef AGGPLOT_CONTOUR_H
+#define AGGPLOT_CONTOUR_H
+
+#include "agg_basics.h"
+#include "agg_array.h"
+
+// Used to refine the position where a contour line crosses an edge of
+// the grid. The method "eval" returns the value of the function in a
+// point or NaN to stop the computation.
+struct contour_function {
+    virtual double eval(double x, double y) = 0;
+    virtual ~contour_function() { }
+};
+
+struct contour_point {
+    double x, y;
+    // True if the segment that goes to the next point of the loop is
+    // part of a contour line and not of the border of the domain.
+    bool line;
+};
+
+// Closed loops, each one given by its points without repeating the
+// first one.
+struct contour_loops {
+    agg::pod_bvector<contour_point> points;
+    agg::pod_bvector<unsigned> ends;
+
+    unsigned loops_number() const { return ends.size(); }
+    unsigned loop_start(unsigned k) const { return (k > 0 ? ends[k-1] : 0); }
+    unsigned loop_end(unsigned k) const { return ends[k]; }
+
+    void clear() {
+        points.remove_all();
+        ends.remove_all();
+    }
+};
+
+// Regular grid of (nx+1) x (ny+1) values over a rectangle. The values
+// are stored by rows, the row i corresponds to y = y1 + i * (y2 - y1) / ny.
+class contour_grid {
+public:
+    contour_grid(double x1, double y1, double x2, double y2, unsigned nx, unsigned ny);
+
+    double* values() { return m_z.data(); }
+
+    unsigned nx() const { return m_nx; }
+    unsigned ny() const { return m_ny; }
+
+    double cell_size() const { return (m_dx < m_dy ? m_dx : m_dy); }
+
+    // Compute the boundary of the region where the values are greater or
+    // equal to "level" using marching squares. The loops are oriented
+    // counterclockwise around the region so that the holes are given
+    // clockwise. If "f" is given the crossing points are refined up to
+    // the tolerance "eps". Return false if the function "f" stops the
+    // computation.
+    bool trace(double level, contour_loops& loops, contour_function* f = 0, double eps = 0.0);
+
+    // The border of the whole grid as a single loop with all the nodes
+    // along the sides.
+    void border(contour_loops& loops) const;
+
+private:
+    enum { no_point = -1 };
+
+    // The points are identified by an index. The crossings on the
+    // horizontal edges come first, then the crossings on the vertical
+    // edges and finally the grid nodes.
+    int hedge(unsigned i, unsigned j) const { return i * m_nx + j; }
+    int vedge(unsigned i, unsigned j) const { return m_hedges + i * (m_nx + 1) + j; }
+    int node(unsigned i, unsigned j) const { return m_hedges + m_vedges + i * (m_nx + 1) + j; }
+    bool is_crossing(int id) const { return id < int(m_hedges + m_vedges); }
+
+    static void border_point(contour_loops& loops, double x, double y) {
+        contour_point p = {x, y, false};
+        loops.points.add(p);
+    }
+
+    void border_edge(unsigned ia, unsigned ja, unsigned ib, unsigned jb, int edge, double level);
+    bool point_coords(int id, double level, contour_function* f, double eps, double* x, double* y) const;
+
+    double m_x1, m_y1, m_dx, m_dy;
+    unsigned m_nx, m_ny;
+    unsigned m_hedges, m_vedges;
+
+    agg::pod_array<double> m_z;
+    agg::pod_array<int> m_next;
+};
+
+#endif
@@ -0,0 +1,431 @@
+
+/* image_writer.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <pthread.h>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "image_writer.h"
+
+enum { png_max_threads = 64 };
+// minimum number of rows compressed by each thread
+enum { png_min_block_rows = 64 };
+
+static unsigned cpu_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0 ? n : 1);
+#endif
+}
+
+image_format_e image_format_from_filename(const char* fn)
+{
+    const char* ext = NULL;
+    for (const char* p = fn; *p; p++) {
+        if (*p == '.')
+            ext = p + 1;
+        else if (*p == '/' || *p == '\\')
+            ext = NULL;
+    }
+    if (!ext || strlen(ext) != 3)
+        return image_format_native;
+
+    char lext[4];
+    for (int k = 0; k < 4; k++)
+        lext[k] = tolower(ext[k]);
+    if (strcmp(lext, "png") == 0)
+        return image_format_png;
+    if (strcmp(lext, "qoi") == 0)
+        return image_format_qoi;
+    return image_format_native;
+}
+
+static void put_be32(unsigned char* p, unsigned long v)
+{
+    p[0] = (v >> 24) & 0xff;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+static inline unsigned char paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    return (pb <= pc ? b : c);
+}
+
+// Filter a row with all the PNG filters and return the one with the
+// smallest sum of the absolute values of the bytes, taken as signed,
+// as recommended by the PNG specification. Each line in "lines" has
+// the filter type as first byte. The previous row "up" can be NULL.
+static const unsigned char* png_filter_row(const unsigned char* row, const unsigned char* up,
+                                           unsigned n, unsigned char* lines[5])
+{
+    const unsigned bpp = 3;
+    unsigned long sum[5] = {0, 0, 0, 0, 0};
+    unsigned char *none = lines[0] + 1, *sub = lines[1] + 1, *upf = lines[2] + 1;
+    unsigned char *avg = lines[3] + 1, *pae = lines[4] + 1;
+
+    for (unsigned i = 0; i < n; i++) {
+        const int x = row[i];
+        const int a = (i >= bpp ? row[i - bpp] : 0);
+        const int b = (up ? up[i] : 0);
+        const int c = (up && i >= bpp ? up[i - bpp] : 0);
+        none[i] = x;
+        sub[i] = x - a;
+        upf[i] = x - b;
+        avg[i] = x - ((a + b) >> 1);
+        pae[i] = x - paeth(a, b, c);
+        sum[0] += (x < 128 ? x : 256 - x);
+        sum[1] += abs((signed char) sub[i]);
+        sum[2] += abs((signed char) upf[i]);
+        sum[3] += abs((signed char) avg[i]);
+        sum[4] += abs((signed char) pae[i]);
+    }
+
+    int best = 0;
+    for (int k = 1; k < 5; k++) {
+        if (sum[k] < sum[best])
+            best = k;
+    }
+    lines[best][0] = best;
+    return lines[best];
+}
+
+// A block of consecutive rows compressed by a thread as a raw deflate
+// stream. All the blocks but the last are terminated with a sync flush
+// so that they can be concatenated to form a single stream.
+struct png_block {
+    const image_source* src;
+    unsigned y0, y1;
+    bool last;
+
+    unsigned char* out;
+    unsigned long out_size, out_len;
+    unsigned long adler;
+    bool ok;
+};
+
+static bool png_block_grow(png_block* b, z_stream* z)
+{
+    unsigned long size = 2 * b->out_size;
+    unsigned char* out = new(std::nothrow) unsigned char[size];
+    if (!out)
+        return false;
+    memcpy(out, b->out, b->out_len);
+    delete [] b->out;
+    b->out = out;
+    b->out_size = size;
+    z->next_out = out + b->out_len;
+    z->avail_out = size - b->out_len;
+    return true;
+}
+
+static bool png_block_deflate(png_block* b, z_stream* z, int flush)
+{
+    for (;;) {
+        if (z->avail_out == 0 && !png_block_grow(b, z))
+            return false;
+        const int status = deflate(z, flush);
+        b->out_len = b->out_size - z->avail_out;
+        if (status == Z_STREAM_ERROR)
+            return false;
+        if (flush == Z_FINISH ? status == Z_STREAM_END : z->avail_in == 0 && z->avail_out > 0)
+            return true;
+    }
+}
+
+static bool png_block_compress(png_block* b, unsigned char* scratch)
+{
+    const unsigned n = b->src->width() * 3;
+    unsigned char* lines[5];
+    for (int k = 0; k < 5; k++)
+        lines[k] = scratch + k * (n + 1);
+    // the two rows buffers are alternated so that the previous row
+    // stays available when a conversion is needed.
+    unsigned char* tmp[2] = {scratch + 5 * (n + 1), scratch + 5 * (n + 1) + n};
+
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    b->out_size = (b->y1 - b->y0) * (n + 1) / 4 + 1024;
+    b->out = new(std::nothrow) unsigned char[b->out_size];
+    if (!b->out) {
+        deflateEnd(&z);
+        return false;
+    }
+    z.next_out = b->out;
+    z.avail_out = b->out_size;
+
+    const unsigned char* up = (b->y0 > 0 ? b->src->row(b->y0 - 1, tmp[(b->y0 - 1) % 2]) : NULL);
+    bool ok = true;
+    for (unsigned y = b->y0; ok && y < b->y1; y++) {
+        const unsigned char* row = b->src->row(y, tmp[y % 2]);
+        const unsigned char* line = png_filter_row(row, up, n, lines);
+        b->adler = adler32(b->adler, line, n + 1);
+        z.next_in = (Bytef*) line;
+        z.avail_in = n + 1;
+        ok = png_block_deflate(b, &z, Z_NO_FLUSH);
+        up = row;
+    }
+    if (ok)
+        ok = png_block_deflate(b, &z, b->last ? Z_FINISH : Z_SYNC_FLUSH);
+    deflateEnd(&z);
+    return ok;
+}
+
+static void* png_block_run(void* data)
+{
+    png_block* b = (png_block*) data;
+    const unsigned n = b->src->width() * 3;
+    unsigned char* scratch = new(std::nothrow) unsigned char[5 * (n + 1) + 2 * n];
+    b->ok = (scratch && png_block_compress(b, scratch));
+    delete [] scratch;
+    return NULL;
+}
+
+static void png_chunk(FILE* f, const char* type, const unsigned char* head, unsigned head_len,
+                      const unsigned char* data, unsigned long len,
+                      const unsigned char* tail, unsigned tail_len)
+{
+    unsigned char buf[4];
+    put_be32(buf, head_len + len + tail_len);
+    fwrite(buf, 1, 4, f);
+    fwrite(type, 1, 4, f);
+    unsigned long crc = crc32(0, (const Bytef*) type, 4);
+    if (head_len > 0) {
+        fwrite(head, 1, head_len, f);
+        crc = crc32(crc, head, head_len);
+    }
+    if (len > 0) {
+        fwrite(data, 1, len, f);
+        crc = crc32(crc, data, len);
+    }
+    if (tail_len > 0) {
+        fwrite(tail, 1, tail_len, f);
+        crc = crc32(crc, tail, tail_len);
+    }
+    put_be32(buf, crc);
+    fwrite(buf, 1, 4, f);
+}
+
+bool write_png(FILE* f, const image_source& src, unsigned threads)
+{
+    const unsigned w = src.width(), h = src.height();
+    if (w == 0 || h == 0)
+        return false;
+
+    unsigned nblocks = (threads > 0 ? threads : cpu_count());
+    if (nblocks > png_max_threads)
+        nblocks = png_max_threads;
+    if (nblocks > h / png_min_block_rows)
+        nblocks = h / png_min_block_rows;
+    if (nblocks < 1)
+        nblocks = 1;
+
+    png_block blocks[png_max_threads];
+    pthread_t tid[png_max_threads];
+    for (unsigned k = 0; k < nblocks; k++) {
+        png_block* b = &blocks[k];
+        b->src = &src;
+        b->y0 = (unsigned long) h * k / nblocks;
+        b->y1 = (unsigned long) h * (k + 1) / nblocks;
+        b->last = (k + 1 == nblocks);
+        b->out = NULL;
+        b->out_size = b->out_len = 0;
+        b->adler = adler32(0, NULL, 0);
+        b->ok = false;
+    }
+
+    // the first block is compressed in the current thread, like the
+    // blocks whose thread cannot be created.
+    unsigned nstarted;
+    for (nstarted = 1; nstarted < nblocks; nstarted++) {
+        if (pthread_create(&tid[nstarted], NULL, png_block_run, &blocks[nstarted]) != 0)
+            break;
+    }
+    png_block_run(&blocks[0]);
+    for (unsigned k = nstarted; k < nblocks; k++)
+        png_block_run(&blocks[k]);
+
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    fwrite(signature, 1, 8, f);
+
+    unsigned char ihdr[13];
+    put_be32(ihdr, w);
+    put_be32(ihdr + 4, h);
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 2;  // truecolor
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    png_chunk(f, "IHDR", NULL, 0, ihdr, 13, NULL, 0);
+
+    // each block is written in its own IDAT chunk as soon as it is
+    // ready, the zlib header goes in the first one and the checksum of
+    // the whole stream in the last one.
+    static const unsigned char zlib_header[2] = {0x78, 0x9c};
+    const unsigned long row_len = 3 * w + 1;
+    unsigned long adler = adler32(0, NULL, 0);
+    bool ok = true;
+    for (unsigned k = 0; k < nblocks; k++) {
+        png_block* b = &blocks[k];
+        if (k > 0 && k < nstarted)
+            pthread_join(tid[k], NULL);
+        ok = ok && b->ok;
+        if (ok) {
+            adler = adler32_combine(adler, b->adler, (b->y1 - b->y0) * row_len);
+            unsigned char adler_be[4];
+            put_be32(adler_be, adler);
+            png_chunk(f, "IDAT", zlib_header, (k == 0 ? 2 : 0), b->out, b->out_len,
+                      adler_be, (b->last ? 4 : 0));
+        }
+        delete [] b->out;
+    }
+    if (!ok)
+        return false;
+
+    png_chunk(f, "IEND", NULL, 0, NULL, 0, NULL, 0);
+    return !ferror(f);
+}
+
+// Buffered output of the QOI encoder.
+class qoi_output {
+public:
+    enum { buffer_size = 1 << 16 };
+
+    qoi_output(FILE* f): m_file(f), m_pos(0) { }
+    ~qoi_output() { flush(); }
+
+    void put(unsigned char c) {
+        if (m_pos == buffer_size)
+            flush();
+        m_buffer[m_pos++] = c;
+    }
+
+    void flush() {
+        if (m_pos > 0)
+            fwrite(m_buffer, 1, m_pos, m_file);
+        m_pos = 0;
+    }
+
+private:
+    FILE* m_file;
+    unsigned char m_buffer[buffer_size];
+    unsigned m_pos;
+};
+
+bool write_qoi(FILE* f, const image_source& src)
+{
+    const unsigned w = src.width(), h = src.height();
+    if (w == 0 || h == 0)
+        return false;
+
+    unsigned char* tmp = new(std::nothrow) unsigned char[3 * w];
+    if (!tmp)
+        return false;
+
+    unsigned char header[14] = {'q', 'o', 'i', 'f'};
+    put_be32(header + 4, w);
+    put_be32(header + 8, h);
+    header[12] = 3;  // channels
+    header[13] = 0;  // sRGB with linear alpha
+    fwrite(header, 1, 14, f);
+
+    qoi_output out(f);
+    // The entries of the index are RGBA and start at (0, 0, 0, 0) like
+    // in the decoder so an opaque black pixel never matches an entry not
+    // yet set. The initial pixel is black with alpha 255.
+    unsigned char index[64][4];
+    memset(index, 0, sizeof(index));
+    int pr = 0, pg = 0, pb = 0;
+    unsigned run = 0;
+    for (unsigned y = 0; y < h; y++) {
+        const unsigned char* row = src.row(y, tmp);
+        const bool last_row = (y + 1 == h);
+        for (unsigned x = 0; x < w; x++) {
+            const int r = row[3*x], g = row[3*x+1], b = row[3*x+2];
+            if (r == pr && g == pg && b == pb) {
+                run++;
+                if (run == 62 || (last_row && x + 1 == w)) {
+                    out.put(0xc0 | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out.put(0xc0 | (run - 1));
+                run = 0;
+            }
+
+            const int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            unsigned char* ip = index[hash];
+            if (ip[0] == r && ip[1] == g && ip[2] == b && ip[3] == 255) {
+                out.put(hash);
+            } else {
+                ip[0] = r;
+                ip[1] = g;
+                ip[2] = b;
+                ip[3] = 255;
+                const int dr = (signed char)(r - pr), dg = (signed char)(g - pg), db = (signed char)(b - pb);
+                const int dr_dg = dr - dg, db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out.put(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    out.put(0x80 | (dg + 32));
+                    out.put((dr_dg + 8) << 4 | (db_dg + 8));
+                } else {
+                    out.put(0xfe);
+                    out.put(r);
+                    out.put(g);
+                    out.put(b);
+                }
+            }
+            pr = r;
+            pg = g;
+            pb = b;
+        }
+    }
+
+    for (int k = 0; k < 7; k++)
+        out.put(0);
+    out.put(1);
+    out.flush();
+
+    delete [] tmp;
+    return !ferror(f);
+}
@@ -0,0 +1,36 @@
+#ifndef AGGPLOT_IMAGE_WRITER_H
+#define AGGPLOT_IMAGE_WRITER_H
+
+#include <stdio.h>
+
+// Rows of an image in rgb24 format, from the top. When the pixels need
+// a conversion the row is written in "tmp", a buffer of width() * 3
+// bytes, otherwise a pointer to the image data itself can be returned.
+// The method "row" may be called by several threads at the same time.
+class image_source {
+public:
+    virtual ~image_source() { }
+
+    virtual unsigned width() const = 0;
+    virtual unsigned height() const = 0;
+    virtual const unsigned char* row(unsigned y, unsigned char* tmp) const = 0;
+};
+
+enum image_format_e {
+    image_format_native = 0,
+    image_format_png,
+    image_format_qoi,
+};
+
+// Format given by the extension of the filename, case insensitive. The
+// native format, PPM or BMP, is returned for any other extension.
+extern image_format_e image_format_from_filename(const char* fn);
+
+// The scanlines are filtered and compressed in blocks of rows, each one
+// by its own thread, and written as separate IDAT chunks. If "threads"
+// is zero the number of processors is used.
+extern bool write_png(FILE* f, const image_source& src, unsigned threads = 0);
+
+extern bool write_qoi(FILE* f, const image_source& src);
+
+#endif
@@ -0,0 +1,362 @@
+
+/* lua-contour.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include "lua-contour.h"
+#include "gs-types.h"
+#include "lua-properties.h"
+#include "lua-cpp-utils.h"
+
+#include "contour.h"
+#include "path.h"
+
+// Limit on the number of subdivisions along each side of the grid.
+static const lua_Integer contour_max_grid = 1 << 14;
+
+static int contour_grid_new    (lua_State *L);
+static int contour_grid_free   (lua_State *L);
+static int contour_grid_buffer (lua_State *L);
+static int contour_grid_build  (lua_State *L);
+
+static contour_grid* check_contour_grid (lua_State *L, int index);
+
+static const struct luaL_Reg contour_functions[] = {
+    {"contour_grid", contour_grid_new},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg contour_grid_metatable[] = {
+    {"__gc",        contour_grid_free},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg contour_grid_methods[] = {
+    {"buffer",      contour_grid_buffer},
+    {"contour",     contour_grid_build},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg contour_grid_properties_get[] = {
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg contour_grid_properties_set[] = {
+    {NULL, NULL}
+};
+
+// Function given from Lua, the error message is left on the stack if
+// the call fails.
+class lua_contour_function : public contour_function {
+public:
+    lua_contour_function(lua_State *L, int index): m_L(L), m_index(index) { }
+
+    virtual double eval(double x, double y)
+    {
+        lua_pushvalue(m_L, m_index);
+        lua_pushnumber(m_L, x);
+        lua_pushnumber(m_L, y);
+        if (lua_pcall(m_L, 2, 1, 0) != 0) {
+            return NAN;
+        }
+        const double z = lua_tonumber(m_L, -1);
+        if (!lua_isnumber(m_L, -1) || z != z) {
+            lua_pop(m_L, 1);
+            lua_pushfstring(m_L, "function eval at: (%f, %f) does not give a number", x, y);
+            return NAN;
+        }
+        lua_pop(m_L, 1);
+        return z;
+    }
+
+private:
+    lua_State *m_L;
+    int m_index;
+};
+
+// Write the vertices in a path applying the optional map given by the
+// Lua function at "index". The points too close to the preceding one
+// are skipped.
+class contour_path_writer {
+public:
+    contour_path_writer(lua_State *L, int index, double tol):
+        m_L(L), m_index(index), m_tol(tol), m_path(0)
+    { }
+
+    void path(agg::path_storage* ps) { m_path = ps; }
+
+    bool move_to(double x, double y)
+    {
+        m_x = x;
+        m_y = y;
+        if (!map(&x, &y))
+            return false;
+        m_path->move_to(x, y);
+        return true;
+    }
+
+    bool line_to(double x, double y)
+    {
+        if (fabs(x - m_x) < m_tol && fabs(y - m_y) < m_tol)
+            return true;
+        m_x = x;
+        m_y = y;
+        if (!map(&x, &y))
+            return false;
+        m_path->line_to(x, y);
+        return true;
+    }
+
+    void close() { m_path->close_polygon(); }
+
+private:
+    bool map(double* x, double* y)
+    {
+        if (m_index == 0)
+            return true;
+        lua_pushvalue(m_L, m_index);
+        lua_pushnumber(m_L, *x);
+        lua_pushnumber(m_L, *y);
+        if (lua_pcall(m_L, 2, 2, 0) != 0)
+            return false;
+        *x = lua_tonumber(m_L, -2);
+        *y = lua_tonumber(m_L, -1);
+        lua_pop(m_L, 2);
+        return true;
+    }
+
+    lua_State *m_L;
+    int m_index;
+    double m_tol;
+    agg::path_storage* m_path;
+    double m_x, m_y;
+};
+
+contour_grid *
+check_contour_grid (lua_State *L, int index)
+{
+    return (contour_grid *) gs_check_userdata (L, index, GS_CONTOUR_GRID);
+}
+
+int
+contour_grid_new (lua_State *L)
+{
+    double x1 = luaL_checknumber (L, 1);
+    double y1 = luaL_checknumber (L, 2);
+    double x2 = luaL_checknumber (L, 3);
+    double y2 = luaL_checknumber (L, 4);
+    lua_Integer nx = luaL_checkinteger (L, 5);
+    lua_Integer ny = luaL_checkinteger (L, 6);
+    if (nx <= 0 || ny <= 0 || nx > contour_max_grid || ny > contour_max_grid)
+        return luaL_error (L, "invalid contour grid size");
+    if (!(x2 > x1) || !(y2 > y1))
+        return luaL_error (L, "invalid contour grid rectangle");
+    new(L, GS_CONTOUR_GRID) contour_grid(x1, y1, x2, y2, nx, ny);
+    return 1;
+}
+
+int
+contour_grid_free (lua_State *L)
+{
+    return object_free<contour_grid>(L, 1, GS_CONTOUR_GRID);
+}
+
+// Return the buffer with the (nx+1) * (ny+1) values of the grid stored
+// by rows, to be accessed with the FFI.
+int
+contour_grid_buffer (lua_State *L)
+{
+    contour_grid *g = check_contour_grid (L, 1);
+    lua_pushlightuserdata (L, g->values());
+    return 1;
+}
+
+static bool
+loop_write(contour_path_writer& w, const contour_loops& loops, unsigned k, bool reverse)
+{
+    const unsigned a = loops.loop_start(k), b = loops.loop_end(k);
+    for (unsigned i = a; i < b; i++)
+    {
+        const contour_point& p = loops.points[reverse ? a + b - 1 - i : i];
+        if (!(i == a ? w.move_to(p.x, p.y) : w.line_to(p.x, p.y)))
+            return false;
+    }
+    w.close();
+    return true;
+}
+
+static bool
+loops_write(contour_path_writer& w, const contour_loops& loops, bool reverse)
+{
+    for (unsigned k = 0; k < loops.loops_number(); k++)
+    {
+        if (!loop_write(w, loops, k, reverse))
+            return false;
+    }
+    return true;
+}
+
+// Write the segments that are part of the contour lines, either closed
+// loops or open lines that end on the border.
+static bool
+lines_write(contour_path_writer& w, const contour_loops& loops)
+{
+    for (unsigned k = 0; k < loops.loops_number(); k++)
+    {
+        const unsigned a = loops.loop_start(k), n = loops.loop_end(k) - a;
+        unsigned s = 0;
+        while (s < n && loops.points[a + s].line)
+            s++;
+
+        if (s == n)
+        {
+            if (!loop_write(w, loops, k, false))
+                return false;
+            continue;
+        }
+
+        for (unsigned c = 1; c <= n; c++)
+        {
+            const contour_point& p = loops.points[a + (s + c) % n];
+            const contour_point& prev = loops.points[a + (s + c - 1) % n];
+            bool success = true;
+            if (prev.line)
+                success = w.line_to(p.x, p.y);
+            else if (p.line)
+                success = w.move_to(p.x, p.y);
+            if (!success)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool
+contour_write(lua_State *L, contour_grid *g, const double* levels, int nlevels,
+              lua_contour_function* f, double eps, contour_path_writer& w)
+{
+    contour_loops loops[2];
+    contour_loops *lower = loops, *upper = loops + 1;
+
+    agg::path_storage* lines = &push_new_object<draw::path>(L, GS_DRAW_PATH)->self();
+    int lines_index = lua_gettop (L);
+    lua_createtable (L, nlevels + 1, 0);
+    int bands_index = lua_gettop (L);
+
+    // The region between two levels is given by the loops of the lower
+    // level and by the loops of the upper level reversed. Filled with the
+    // non-zero rule it does not include the region above the upper level.
+    g->border(*lower);
+    for (int k = 0; k <= nlevels; k++)
+    {
+        upper->clear();
+        if (k < nlevels)
+        {
+            if (!g->trace(levels[k], *upper, f, eps))
+                return false;
+            w.path(lines);
+            if (!lines_write(w, *upper))
+                return false;
+        }
+
+        if (lower->loops_number() > 0)
+        {
+            w.path(&push_new_object<draw::path>(L, GS_DRAW_PATH)->self());
+            if (!loops_write(w, *lower, false) || !loops_write(w, *upper, true))
+                return false;
+        }
+        else
+        {
+            lua_pushboolean (L, 0);
+        }
+        lua_rawseti (L, bands_index, k + 1);
+
+        contour_loops* tmp = lower;
+        lower = upper;
+        upper = tmp;
+    }
+
+    if (lines->total_vertices() == 0)
+    {
+        lua_pushboolean (L, 0);
+        lua_replace (L, lines_index);
+    }
+    lua_insert (L, lines_index);
+    return true;
+}
+
+// Return a table with the paths of the regions between the levels,
+// including the region below the first level and above the last one,
+// and a path with all the contour lines. Empty regions are given as
+// false. The optional function "f" is used to refine the crossing
+// points and "map" to transform the coordinates.
+int
+contour_grid_build (lua_State *L)
+{
+    contour_grid *g = check_contour_grid (L, 1);
+    luaL_checktype (L, 2, LUA_TTABLE);
+    const bool refine = !lua_isnoneornil (L, 3);
+    const bool mapping = !lua_isnoneornil (L, 4);
+    if (refine)
+        luaL_checktype (L, 3, LUA_TFUNCTION);
+    if (mapping)
+        luaL_checktype (L, 4, LUA_TFUNCTION);
+
+    const int nlevels = lua_objlen (L, 2);
+    if (nlevels == 0)
+        return luaL_error (L, "no contour levels given");
+    double* levels = (double*) lua_newuserdata (L, nlevels * sizeof(double));
+    for (int k = 0; k < nlevels; k++)
+    {
+        lua_rawgeti (L, 2, k + 1);
+        if (!lua_isnumber (L, -1))
+            return luaL_error (L, "contour levels should be numbers");
+        levels[k] = lua_tonumber (L, -1);
+        lua_pop (L, 1);
+        if (k > 0 && !(levels[k] > levels[k - 1]))
+            return luaL_error (L, "contour levels should be increasing");
+    }
+
+    const double step = (nlevels > 1 ? (levels[nlevels - 1] - levels[0]) / (nlevels - 1) : fabs(levels[0]));
+    const double eps = 1e-5 * step;
+
+    lua_contour_function f(L, 3);
+    contour_path_writer w(L, mapping ? 4 : 0, 1e-3 * g->cell_size());
+
+    if (!contour_write(L, g, levels, nlevels, refine ? &f : 0, eps, w))
+        return lua_error (L);
+    return 2;
+}
+
+void
+contour_register (lua_State *L)
+{
+    luaL_newmetatable (L, GS_METATABLE(GS_CONTOUR_GRID));
+    register_properties_index(L, contour_grid_methods, contour_grid_properties_get, contour_grid_properties_set);
+    luaL_register (L, NULL, contour_grid_metatable);
+    lua_pop (L, 1);
+
+    luaL_register (L, NULL, contour_functions);
+}
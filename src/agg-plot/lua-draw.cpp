@@ -42,6 +42,7 @@ enum path_cmd_e {
     CMD_ARC_TO,
     CMD_CURVE3,
     CMD_CURVE4,
+    CMD_CLEAR,
     CMD_ERROR,
 };
 
@@ -76,6 +77,7 @@ static struct path_cmd_reg cmd_table[] = {
     {"arc_to",   "fffbbff"},
     {"curve3",   "ffff"},
     {"curve4",   "ffffff"},
+    {"clear",    ""},
     {NULL, NULL}
 };
 
@@ -171,10 +173,15 @@ path_cmd (draw::path *p, int _cmd, struct cmd_call_stack *s)
     case CMD_CURVE4:
         ps.curve4 (s->f[0], s->f[1], s->f[2], s->f[3], s->f[4], s->f[5]);
         break;
+    case CMD_CLEAR:
+        ps.remove_all ();
+        break;
     default:
         /* */
         ;
     }
+
+    p->modified();
 }
 
 static int
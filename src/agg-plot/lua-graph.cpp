@@ -28,6 +28,9 @@ extern "C" {
 #include "window_registry.h"
 #include "lua-draw.h"
 #include "lua-text.h"
+#include "lua-mesh.h"
+#include "lua-stream.h"
+#include "lua-contour.h"
 #include "window.h"
 #include "lua-plot.h"
 #include "window_hooks.h"
@@ -40,6 +43,18 @@ static const struct luaL_Reg methods_dummy[] = {{NULL, NULL}};
 
 pthread_mutex_t agg_mutex[1];
 
+void
+gsl_shell_graph_lock ()
+{
+    AGG_LOCK();
+}
+
+void
+gsl_shell_graph_unlock ()
+{
+    AGG_UNLOCK();
+}
+
 void
 graph_close_windows (lua_State *L)
 {
@@ -64,6 +79,9 @@ register_graph (lua_State *L)
     luaL_register (L, MLUA_GRAPHLIBNAME, methods_dummy);
     draw_register (L);
     text_register (L);
+    mesh_register (L);
+    stream_register (L);
+    contour_register (L);
     app_window_hooks->register_module (L);
     plot_register (L);
 
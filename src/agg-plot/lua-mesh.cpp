@@ -0,0 +1,184 @@
+
+/* lua-mesh.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include "lua-mesh.h"
+#include "lua-graph.h"
+#include "gs-types.h"
+#include "lua-properties.h"
+#include "lua-cpp-utils.h"
+#include "colors.h"
+
+#include "mesh3d.h"
+
+// Limit on the number of vertices or triangles so that the size of the
+// buffers can be always represented with an unsigned.
+static const lua_Integer mesh_max_size = 1 << 26;
+
+static int agg_mesh_new     (lua_State *L);
+static int agg_mesh_free    (lua_State *L);
+static int agg_mesh_buffers (lua_State *L);
+static int agg_mesh_update  (lua_State *L);
+static int agg_mesh_view    (lua_State *L);
+static int agg_mesh_colors  (lua_State *L);
+
+static int agg_mesh_vertices_get  (lua_State *L);
+static int agg_mesh_triangles_get (lua_State *L);
+
+static draw::mesh3d* check_agg_mesh (lua_State *L, int index);
+
+static const struct luaL_Reg mesh_functions[] = {
+    {"mesh",        agg_mesh_new},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg mesh_metatable[] = {
+    {"__gc",        agg_mesh_free},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg mesh_methods[] = {
+    {"buffers",     agg_mesh_buffers},
+    {"update",      agg_mesh_update},
+    {"view",        agg_mesh_view},
+    {"colors",      agg_mesh_colors},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg mesh_properties_get[] = {
+    {"vertices",    agg_mesh_vertices_get},
+    {"triangles",   agg_mesh_triangles_get},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg mesh_properties_set[] = {
+    {NULL, NULL}
+};
+
+draw::mesh3d *
+check_agg_mesh (lua_State *L, int index)
+{
+    return (draw::mesh3d *) gs_check_userdata (L, index, GS_DRAW_MESH);
+}
+
+int
+agg_mesh_new (lua_State *L)
+{
+    lua_Integer nv = luaL_checkinteger (L, 1);
+    lua_Integer nt = luaL_checkinteger (L, 2);
+    if (nv <= 0 || nt <= 0 || nv > mesh_max_size || nt > mesh_max_size)
+        return luaL_error (L, "invalid mesh size");
+    new(L, GS_DRAW_MESH) draw::mesh3d(nv, nt);
+    return 1;
+}
+
+int
+agg_mesh_free (lua_State *L)
+{
+    return object_free<draw::mesh3d>(L, 1, GS_DRAW_MESH);
+}
+
+// Return the vertex buffer, with three doubles for each vertex, and the
+// index buffer, with three unsigned int for each triangle, to be
+// accessed with the FFI.
+int
+agg_mesh_buffers (lua_State *L)
+{
+    draw::mesh3d *m = check_agg_mesh (L, 1);
+    lua_pushlightuserdata (L, m->vertices());
+    lua_pushlightuserdata (L, m->triangles());
+    return 2;
+}
+
+int
+agg_mesh_update (lua_State *L)
+{
+    draw::mesh3d *m = check_agg_mesh (L, 1);
+    AGG_LOCK();
+    bool success = m->update();
+    m->modified();
+    AGG_UNLOCK();
+    if (!success)
+        return luaL_error (L, "invalid vertex index in mesh triangles");
+    return 0;
+}
+
+int
+agg_mesh_view (lua_State *L)
+{
+    draw::mesh3d *m = check_agg_mesh (L, 1);
+    double rx = luaL_checknumber (L, 2);
+    double ry = luaL_checknumber (L, 3);
+    double rz = luaL_optnumber (L, 4, 0.0);
+    AGG_LOCK();
+    m->view(rx, ry, rz);
+    m->modified();
+    AGG_UNLOCK();
+    return 0;
+}
+
+int
+agg_mesh_colors (lua_State *L)
+{
+    draw::mesh3d *m = check_agg_mesh (L, 1);
+    agg::rgba8 back = color_arg_lookup (L, 2);
+    bool edges = !lua_isnoneornil (L, 3);
+    agg::rgba8 edge = (edges ? color_arg_lookup (L, 3) : back);
+    AGG_LOCK();
+    m->back_color(back);
+    if (edges)
+        m->edge_color(edge);
+    else
+        m->edges_disable();
+    m->modified();
+    AGG_UNLOCK();
+    return 0;
+}
+
+int
+agg_mesh_vertices_get (lua_State *L)
+{
+    draw::mesh3d *m = check_agg_mesh (L, 1);
+    lua_pushinteger (L, m->vertices_number());
+    return 1;
+}
+
+int
+agg_mesh_triangles_get (lua_State *L)
+{
+    draw::mesh3d *m = check_agg_mesh (L, 1);
+    lua_pushinteger (L, m->triangles_number());
+    return 1;
+}
+
+void
+mesh_register (lua_State *L)
+{
+    luaL_newmetatable (L, GS_METATABLE(GS_DRAW_MESH));
+    register_properties_index(L, mesh_methods, mesh_properties_get, mesh_properties_set);
+    luaL_register (L, NULL, mesh_metatable);
+    lua_pop (L, 1);
+
+    luaL_register (L, NULL, mesh_functions);
+}
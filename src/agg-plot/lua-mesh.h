@@ -0,0 +1,14 @@
+#ifndef AGGPLOT_LUA_MESH_H
+#define AGGPLOT_LUA_MESH_H
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+#include <lua.h>
+
+extern void mesh_register (lua_State *L);
+
+__END_DECLS
+
+#endif
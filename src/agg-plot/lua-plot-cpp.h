@@ -9,8 +9,11 @@ extern "C" {
 
 #include "plot-auto.h"
 #include "resource-manager.h"
+#include "render_stats.h"
 
 typedef plot sg_plot;
 typedef plot_auto sg_plot_auto;
 
+extern void render_stats_push (lua_State *L, const render_stats& stats);
+
 #endif
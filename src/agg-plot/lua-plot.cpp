@@ -79,8 +79,11 @@ static int plot_pad_mode_get (lua_State *L);
 static int plot_pad_mode_set (lua_State *L);
 static int plot_clip_mode_get (lua_State *L);
 static int plot_clip_mode_set (lua_State *L);
+static int plot_stats_overlay_get (lua_State *L);
+static int plot_stats_overlay_set (lua_State *L);
 
 static int canvas_new      (lua_State *L);
+static int plot_stats      (lua_State *L);
 
 static int   plot_add_gener  (lua_State *L, bool as_line);
 static void  plot_update_raw (lua_State *L, sg_plot *p, int plot_index);
@@ -88,6 +91,7 @@ static void  plot_update_raw (lua_State *L, sg_plot *p, int plot_index);
 static const struct luaL_Reg plot_functions[] = {
     {"plot",        plot_new},
     {"canvas",      canvas_new},
+    {"stats",       plot_stats},
     {NULL, NULL}
 };
 
@@ -126,6 +130,7 @@ static const struct luaL_Reg plot_properties_get[] = {
     {"sync",         plot_sync_mode_get  },
     {"pad",          plot_pad_mode_get  },
     {"clip",         plot_clip_mode_get },
+    {"stats",        plot_stats_overlay_get },
     {NULL, NULL}
 };
 
@@ -141,6 +146,7 @@ static const struct luaL_Reg plot_properties_set[] = {
     {"sync",         plot_sync_mode_set  },
     {"pad",          plot_pad_mode_set  },
     {"clip",         plot_clip_mode_set },
+    {"stats",        plot_stats_overlay_set },
     {NULL, NULL}
 };
 
@@ -525,13 +531,18 @@ void
 plot_update_raw (lua_State *L, sg_plot *p, int plot_index)
 {
     window_refs_lookup_apply (L, plot_index, app_window_hooks->update);
+    AGG_LOCK();
     p->commit_pending_draw();
+    AGG_UNLOCK();
 }
 
 int
 plot_update (lua_State *L)
 {
     sg_plot *p = object_check<sg_plot>(L, 1, GS_PLOT);
+    AGG_LOCK();
+    p->discard_layers_cache();
+    AGG_UNLOCK();
     plot_update_raw (L, p, 1);
     return 0;
 }
@@ -541,7 +552,9 @@ plot_flush (lua_State *L)
 {
     sg_plot *p = object_check<sg_plot>(L, 1, GS_PLOT);
     window_refs_lookup_apply (L, 1, app_window_hooks->refresh);
+    AGG_LOCK();
     p->commit_pending_draw();
+    AGG_UNLOCK();
     return 0;
 }
 
@@ -653,6 +666,7 @@ plot_save_svg (lua_State *L)
     const char *filename = lua_tostring(L, 2);
     double w = luaL_optnumber(L, 3, 800.0);
     double h = luaL_optnumber(L, 4, 600.0);
+    double tolerance = luaL_optnumber(L, 5, 0.0);
 
     if (!filename)
         return gs_type_error(L, 2, "string");
@@ -669,10 +683,10 @@ plot_save_svg (lua_State *L)
     if (!f)
         return luaL_error(L, "cannot open filename: %s", filename);
 
-    canvas_svg canvas(f, h);
+    canvas_svg canvas(f, h, tolerance);
     agg::trans_affine_scaling m(w, h);
     canvas.write_header(w, h);
-    p->draw(canvas, m, NULL);
+    p->draw(canvas, m, NULL, true);
     canvas.write_end();
     fclose(f);
 
@@ -701,6 +715,69 @@ static int plot_clip_mode_get (lua_State *L)
     return plot_bool_property_get(L, &sg_plot::clip_is_active);
 }
 
+static int plot_stats_overlay_set (lua_State *L)
+{
+    plot_bool_property_set(L, &sg_plot::set_stats_overlay, true);
+    return 0;
+}
+
+static int plot_stats_overlay_get (lua_State *L)
+{
+    return plot_bool_property_get(L, &sg_plot::stats_overlay);
+}
+
+static void
+render_counters_push (lua_State *L, const render_stats::counters& c)
+{
+    lua_newtable (L);
+    for (int k = 0; k < render_stats::timers_number; k++)
+    {
+        lua_pushnumber (L, c.time[k] * 1000.0);
+        lua_setfield (L, -2, render_stats::timer_name(render_stats::timer_e(k)));
+    }
+    lua_setfield (L, -2, "time");
+
+    lua_pushnumber (L, (double) c.vertices);
+    lua_setfield (L, -2, "vertices");
+    lua_pushnumber (L, (double) c.scanlines);
+    lua_setfield (L, -2, "scanlines");
+}
+
+/* Push a table with the totals of the stats, the times are given in
+   milliseconds, and with the counters of the last frame in the field
+   "last". */
+void
+render_stats_push (lua_State *L, const render_stats& stats)
+{
+    lua_newtable (L);
+    lua_pushinteger (L, stats.frames());
+    lua_setfield (L, -2, "frames");
+    render_counters_push (L, stats.total());
+
+    lua_newtable (L);
+    render_counters_push (L, stats.frame());
+    lua_setfield (L, -2, "last");
+}
+
+int
+plot_stats (lua_State *L)
+{
+    if (gs_is_userdata (L, 1, GS_WINDOW))
+        return app_window_hooks->stats(L);
+
+    sg_plot *p = object_check<sg_plot>(L, 1, GS_PLOT);
+    bool reset = lua_toboolean (L, 2);
+
+    AGG_LOCK();
+    render_stats stats = p->stats();
+    if (reset)
+        p->stats().clear();
+    AGG_UNLOCK();
+
+    render_stats_push (L, stats);
+    return 1;
+}
+
 int
 plot_sync_mode_get (lua_State *L)
 {
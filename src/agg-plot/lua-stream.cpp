@@ -0,0 +1,166 @@
+
+/* lua-stream.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include "lua-stream.h"
+#include "lua-graph.h"
+#include "gs-types.h"
+#include "lua-properties.h"
+#include "lua-cpp-utils.h"
+
+#include "stream.h"
+
+static const lua_Integer stream_max_capacity = 1 << 26;
+
+static int agg_stream_new    (lua_State *L);
+static int agg_stream_free   (lua_State *L);
+static int agg_stream_append (lua_State *L);
+static int agg_stream_clear  (lua_State *L);
+
+static int agg_stream_window_get   (lua_State *L);
+static int agg_stream_window_set   (lua_State *L);
+static int agg_stream_capacity_get (lua_State *L);
+static int agg_stream_size_get     (lua_State *L);
+
+static draw::stream* check_agg_stream (lua_State *L, int index);
+
+static const struct luaL_Reg stream_functions[] = {
+    {"stream",      agg_stream_new},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg stream_metatable[] = {
+    {"__gc",        agg_stream_free},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg stream_methods[] = {
+    {"append",      agg_stream_append},
+    {"clear",       agg_stream_clear},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg stream_properties_get[] = {
+    {"window",      agg_stream_window_get},
+    {"capacity",    agg_stream_capacity_get},
+    {"size",        agg_stream_size_get},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg stream_properties_set[] = {
+    {"window",      agg_stream_window_set},
+    {NULL, NULL}
+};
+
+draw::stream *
+check_agg_stream (lua_State *L, int index)
+{
+    return (draw::stream *) gs_check_userdata (L, index, GS_DRAW_STREAM);
+}
+
+int
+agg_stream_new (lua_State *L)
+{
+    lua_Integer capacity = luaL_checkinteger (L, 1);
+    if (capacity < 2 || capacity > stream_max_capacity)
+        return luaL_error (L, "invalid stream capacity");
+    new(L, GS_DRAW_STREAM) draw::stream(capacity);
+    return 1;
+}
+
+int
+agg_stream_free (lua_State *L)
+{
+    return object_free<draw::stream>(L, 1, GS_DRAW_STREAM);
+}
+
+int
+agg_stream_append (lua_State *L)
+{
+    draw::stream *s = check_agg_stream (L, 1);
+    double x = gs_check_number (L, 2, FP_CHECK_NORMAL);
+    double y = gs_check_number (L, 3, FP_CHECK_NORMAL);
+    AGG_LOCK();
+    s->append(x, y);
+    AGG_UNLOCK();
+    return 0;
+}
+
+int
+agg_stream_clear (lua_State *L)
+{
+    draw::stream *s = check_agg_stream (L, 1);
+    AGG_LOCK();
+    s->clear();
+    AGG_UNLOCK();
+    return 0;
+}
+
+int
+agg_stream_window_get (lua_State *L)
+{
+    draw::stream *s = check_agg_stream (L, 1);
+    lua_pushnumber (L, s->window());
+    return 1;
+}
+
+int
+agg_stream_window_set (lua_State *L)
+{
+    draw::stream *s = check_agg_stream (L, 1);
+    double w = gs_check_number (L, 2, FP_CHECK_NORMAL);
+    if (w < 0.0)
+        return luaL_error (L, "invalid stream window");
+    AGG_LOCK();
+    s->set_window(w);
+    AGG_UNLOCK();
+    return 0;
+}
+
+int
+agg_stream_capacity_get (lua_State *L)
+{
+    draw::stream *s = check_agg_stream (L, 1);
+    lua_pushinteger (L, s->capacity());
+    return 1;
+}
+
+int
+agg_stream_size_get (lua_State *L)
+{
+    draw::stream *s = check_agg_stream (L, 1);
+    lua_pushinteger (L, s->size());
+    return 1;
+}
+
+void
+stream_register (lua_State *L)
+{
+    luaL_newmetatable (L, GS_METATABLE(GS_DRAW_STREAM));
+    register_properties_index(L, stream_methods, stream_properties_get, stream_properties_set);
+    luaL_register (L, NULL, stream_metatable);
+    lua_pop (L, 1);
+
+    luaL_register (L, NULL, stream_functions);
+}
@@ -0,0 +1,14 @@
+#ifndef AGGPLOT_LUA_STREAM_H
+#define AGGPLOT_LUA_STREAM_H
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+#include <lua.h>
+
+extern void stream_register (lua_State *L);
+
+__END_DECLS
+
+#endif
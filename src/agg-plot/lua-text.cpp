@@ -83,6 +83,7 @@ agg_text_angle_set (lua_State *L)
     draw::text *t = check_agg_text (L, 1);
     double th = luaL_checknumber (L, 2);
     t->angle(th);
+    t->modified();
     return 0;
 }
 
@@ -153,6 +154,7 @@ agg_text_justif_set (lua_State *L)
         t->vjustif(vjf);
     }
 
+    t->modified();
     return 0;
 }
 
@@ -163,6 +165,7 @@ agg_text_set_point (lua_State *L)
     double x = luaL_checknumber (L, 2);
     double y = luaL_checknumber (L, 3);
     t->set_point(x, y);
+    t->modified();
     return 0;
 }
 
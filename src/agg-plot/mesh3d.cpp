@@ -0,0 +1,386 @@
+
+/* mesh3d.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh3d.h"
+
+namespace draw {
+
+// distance of the camera from the center in units of the mesh radius
+static const double camera_distance = 5.0;
+// the vertices nearer than this fraction of the camera distance are
+// not shown
+static const double near_plane = 0.01;
+// fraction of the color given by the ambient light
+static const double ambient_light = 0.2;
+
+static inline double min3(double a, double b, double c) {
+    return (a < b ? (a < c ? a : c) : (b < c ? b : c));
+}
+
+static inline double max3(double a, double b, double c) {
+    return (a > b ? (a > c ? a : c) : (b > c ? b : c));
+}
+
+mesh3d::mesh3d(unsigned nv, unsigned nt):
+    m_vertices(3 * nv), m_triangles(3 * nt),
+    m_radius(0.0), m_distance(camera_distance),
+    m_back_color(0xBF, 0x92, 0x4A), m_edge_color(50, 50, 50), m_edges(false),
+    m_screen(2 * nv), m_inv_depth(nv), m_pixels(), m_zbuffer(), m_vertex_index(0)
+{
+    memset(m_vertices.data(), 0, 3 * nv * sizeof(double));
+    memset(m_triangles.data(), 0, 3 * nt * sizeof(unsigned));
+    memset(m_inv_depth.data(), 0, nv * sizeof(float));
+    m_center[0] = m_center[1] = m_center[2] = 0.0;
+    view(-M_PI / 2 + M_PI / 16, -M_PI / 16, 0.0);
+    m_image.x = m_image.y = 0;
+    m_image.width = m_image.height = 0;
+    m_image.pixels = 0;
+}
+
+bool mesh3d::update()
+{
+    const unsigned nv = vertices_number(), nt = triangles_number();
+    const unsigned* tri = m_triangles.data();
+    for (unsigned k = 0; k < 3 * nt; k++) {
+        if (tri[k] >= nv)
+            return false;
+    }
+
+    const double* v = m_vertices.data();
+    double lo[3], hi[3];
+    bool empty = true;
+    for (unsigned k = 0; k < nv; k++) {
+        const double* p = v + 3 * k;
+        if (!isfinite(p[0]) || !isfinite(p[1]) || !isfinite(p[2]))
+            continue;
+        for (int i = 0; i < 3; i++) {
+            if (empty || p[i] < lo[i]) lo[i] = p[i];
+            if (empty || p[i] > hi[i]) hi[i] = p[i];
+        }
+        empty = false;
+    }
+    if (empty) {
+        m_center[0] = m_center[1] = m_center[2] = 0.0;
+        m_radius = 0.0;
+        return true;
+    }
+
+    for (int i = 0; i < 3; i++)
+        m_center[i] = (lo[i] + hi[i]) / 2;
+
+    double r2 = 0.0;
+    for (unsigned k = 0; k < nv; k++) {
+        const double* p = v + 3 * k;
+        const double dx = p[0] - m_center[0], dy = p[1] - m_center[1], dz = p[2] - m_center[2];
+        const double d2 = dx * dx + dy * dy + dz * dz;
+        if (d2 > r2)
+            r2 = d2;
+    }
+    m_radius = sqrt(r2);
+    return true;
+}
+
+void mesh3d::view(double rx, double ry, double rz)
+{
+    const double cx = cos(rx), sx = sin(rx);
+    const double cy = cos(ry), sy = sin(ry);
+    const double cz = cos(rz), sz = sin(rz);
+
+    // rotation matrix Ry * Rx * Rz by rows
+    const double a[9] = {cz, -sz, 0, cx * sz, cx * cz, -sx, sx * sz, sx * cz, cx};
+    for (int j = 0; j < 3; j++) {
+        m_rot[j]     =  cy * a[j] + sy * a[6 + j];
+        m_rot[3 + j] =  a[3 + j];
+        m_rot[6 + j] = -sy * a[j] + cy * a[6 + j];
+    }
+}
+
+void mesh3d::view_coords(unsigned k, double* x, double* y, double* z) const
+{
+    const double* p = m_vertices.data() + 3 * k;
+    const double px = p[0] - m_center[0], py = p[1] - m_center[1], pz = p[2] - m_center[2];
+    const double* r = m_rot;
+    const double d = m_distance * (m_radius > 0 ? m_radius : 1.0);
+    *x = r[0] * px + r[1] * py + r[2] * pz;
+    *y = r[3] * px + r[4] * py + r[5] * pz;
+    *z = r[6] * px + r[7] * py + r[8] * pz - d;
+}
+
+void mesh3d::apply_transform(const agg::trans_affine& m, double as)
+{
+    const unsigned nv = vertices_number();
+    const double d = m_distance * (m_radius > 0 ? m_radius : 1.0);
+    double* screen = m_screen.data();
+    float* inv_depth = m_inv_depth.data();
+    for (unsigned k = 0; k < nv; k++) {
+        double x, y, z;
+        view_coords(k, &x, &y, &z);
+        if (!isfinite(x) || !isfinite(y) || !(-z > near_plane * d)) {
+            inv_depth[k] = 0;
+            continue;
+        }
+        x *= d / (-z);
+        y *= d / (-z);
+        m.transform(&x, &y);
+        screen[2 * k] = x;
+        screen[2 * k + 1] = y;
+        inv_depth[k] = 1 / (-z);
+    }
+}
+
+// The projection of the mesh is contained in the projection of the
+// sphere around the center so that the bounding box does not depend on
+// the view.
+void mesh3d::bounding_box(double *x1, double *y1, double *x2, double *y2)
+{
+    const double r = (m_radius > 0 ? m_radius : 1.0);
+    const double d = m_distance * r;
+    const double s = r * d / (d - r);
+    *x1 = *y1 = -s;
+    *x2 = *y2 = s;
+}
+
+bool mesh3d::triangle_visible(unsigned t) const
+{
+    const unsigned nv = vertices_number();
+    const unsigned* tri = m_triangles.data() + 3 * t;
+    for (int i = 0; i < 3; i++) {
+        if (tri[i] >= nv || m_inv_depth[tri[i]] <= 0)
+            return false;
+    }
+    return true;
+}
+
+// Flat shading with the light coming from the camera direction. The
+// faces whose normal points away from the camera use the back color.
+agg::rgba8 mesh3d::triangle_color(unsigned t, agg::rgba8 c) const
+{
+    const unsigned* tri = m_triangles.data() + 3 * t;
+    double a[3], b[3], e[3];
+    view_coords(tri[0], a, a + 1, a + 2);
+    view_coords(tri[1], b, b + 1, b + 2);
+    view_coords(tri[2], e, e + 1, e + 2);
+    for (int i = 0; i < 3; i++) {
+        b[i] -= a[i];
+        e[i] -= a[i];
+    }
+    const double nx = b[1] * e[2] - b[2] * e[1];
+    const double ny = b[2] * e[0] - b[0] * e[2];
+    const double nz = b[0] * e[1] - b[1] * e[0];
+    const double nn = sqrt(nx * nx + ny * ny + nz * nz);
+    double intensity = (nn > 0 ? nz / nn : 0.0);
+    if (intensity < 0) {
+        intensity = -intensity;
+        c = agg::rgba8(m_back_color.r, m_back_color.g, m_back_color.b, c.a);
+    }
+    const double k = ambient_light + (1 - ambient_light) * intensity;
+    return agg::rgba8(agg::int8u(c.r * k + 0.5), agg::int8u(c.g * k + 0.5), agg::int8u(c.b * k + 0.5), c.a);
+}
+
+const sg_image* mesh3d::rasterize(const agg::rect_i& clip, agg::rgba8 c)
+{
+    const unsigned nv = vertices_number(), nt = triangles_number();
+    const double* screen = m_screen.data();
+    const float* inv_depth = m_inv_depth.data();
+
+    m_image.width = m_image.height = 0;
+
+    double xmin = HUGE_VAL, ymin = HUGE_VAL, xmax = -HUGE_VAL, ymax = -HUGE_VAL;
+    for (unsigned k = 0; k < nv; k++) {
+        if (inv_depth[k] <= 0)
+            continue;
+        const double x = screen[2 * k], y = screen[2 * k + 1];
+        if (x < xmin) xmin = x;
+        if (x > xmax) xmax = x;
+        if (y < ymin) ymin = y;
+        if (y > ymax) ymax = y;
+    }
+    xmin = (xmin > clip.x1 ? xmin : clip.x1);
+    ymin = (ymin > clip.y1 ? ymin : clip.y1);
+    xmax = (xmax < clip.x2 ? xmax : clip.x2);
+    ymax = (ymax < clip.y2 ? ymax : clip.y2);
+    if (xmin > xmax || ymin > ymax)
+        return &m_image;
+
+    const int x1 = int(floor(xmin)), y1 = int(floor(ymin));
+    const int x2 = int(ceil(xmax)), y2 = int(ceil(ymax));
+    const unsigned w = x2 - x1 + 1, h = y2 - y1 + 1;
+
+    m_pixels.resize(w * h);
+    m_zbuffer.resize(w * h);
+    agg::rgba8* pixels = m_pixels.data();
+    float* zbuffer = m_zbuffer.data();
+    const agg::rgba8 transparent(0, 0, 0, 0);
+    for (unsigned k = 0; k < w * h; k++) {
+        pixels[k] = transparent;
+        zbuffer[k] = 0;
+    }
+
+    // The triangles are rasterized sampling the pixel centers. The
+    // inverse of the depth is linear in the screen coordinates so it is
+    // interpolated using the barycentric coordinates and the nearest
+    // triangle, with the largest value, is kept.
+    for (unsigned t = 0; t < nt; t++) {
+        if (!triangle_visible(t))
+            continue;
+        const unsigned* tri = m_triangles.data() + 3 * t;
+        const double ax = screen[2 * tri[0]], ay = screen[2 * tri[0] + 1];
+        const double bx = screen[2 * tri[1]], by = screen[2 * tri[1] + 1];
+        const double cx = screen[2 * tri[2]], cy = screen[2 * tri[2] + 1];
+        const double area = (bx - ax) * (cy - ay) - (cx - ax) * (by - ay);
+        if (!(fabs(area) > 1e-12))
+            continue;
+
+        const double txmin = min3(ax, bx, cx), txmax = max3(ax, bx, cx);
+        const double tymin = min3(ay, by, cy), tymax = max3(ay, by, cy);
+        if (txmax < x1 || txmin > x2 + 1 || tymax < y1 || tymin > y2 + 1)
+            continue;
+        const int tx1 = (txmin > x1 ? int(floor(txmin)) : x1);
+        const int tx2 = (txmax < x2 ? int(ceil(txmax)) : x2);
+        const int ty1 = (tymin > y1 ? int(floor(tymin)) : y1);
+        const int ty2 = (tymax < y2 ? int(ceil(tymax)) : y2);
+
+        const agg::rgba8 color = triangle_color(t, c);
+        const double inv_area = 1 / area;
+        const float za = inv_depth[tri[0]], zb = inv_depth[tri[1]], zc = inv_depth[tri[2]];
+
+        // factors to obtain the distance in pixels from the edges
+        const double fa = fabs(area) / hypot(cx - bx, cy - by);
+        const double fb = fabs(area) / hypot(ax - cx, ay - cy);
+        const double fc = fabs(area) / hypot(bx - ax, by - ay);
+
+        for (int y = ty1; y <= ty2; y++) {
+            const double py = y + 0.5;
+            agg::rgba8* prow = pixels + (y - y1) * w - x1;
+            float* zrow = zbuffer + (y - y1) * w - x1;
+            for (int x = tx1; x <= tx2; x++) {
+                const double px = x + 0.5;
+                const double la = ((bx - px) * (cy - py) - (cx - px) * (by - py)) * inv_area;
+                const double lb = ((cx - px) * (ay - py) - (ax - px) * (cy - py)) * inv_area;
+                const double lc = 1 - la - lb;
+                if (la < 0 || lb < 0 || lc < 0)
+                    continue;
+                const float iz = la * za + lb * zb + lc * zc;
+                if (iz <= zrow[x])
+                    continue;
+                zrow[x] = iz;
+                if (m_edges) {
+                    const double dist = min3(la * fa, lb * fb, lc * fc);
+                    prow[x] = (dist < 1 ? m_edge_color.gradient(color, dist) : color);
+                } else {
+                    prow[x] = color;
+                }
+            }
+        }
+    }
+
+    m_image.x = x1;
+    m_image.y = y1;
+    m_image.width = w;
+    m_image.height = h;
+    m_image.pixels = pixels;
+    return &m_image;
+}
+
+void mesh3d::rewind(unsigned path_id)
+{
+    m_vertex_index = 0;
+}
+
+unsigned mesh3d::vertex(double* x, double* y)
+{
+    const unsigned nt = triangles_number();
+    unsigned t = m_vertex_index / 4, step = m_vertex_index % 4;
+    if (step == 0) {
+        while (t < nt && !triangle_visible(t))
+            t++;
+        if (t >= nt)
+            return agg::path_cmd_stop;
+    }
+    m_vertex_index = 4 * t + step + 1;
+
+    if (step == 3)
+        return agg::path_cmd_end_poly | agg::path_flags_close;
+
+    const unsigned k = m_triangles[3 * t + step];
+    *x = m_screen[2 * k];
+    *y = m_screen[2 * k + 1];
+    return (step == 0 ? agg::path_cmd_move_to : agg::path_cmd_line_to);
+}
+
+struct depth_order {
+    float inv_depth;
+    unsigned index;
+};
+
+static int depth_order_cmp(const void* pa, const void* pb)
+{
+    const depth_order* a = (const depth_order*) pa;
+    const depth_order* b = (const depth_order*) pb;
+    return (a->inv_depth < b->inv_depth ? -1 : (a->inv_depth > b->inv_depth ? 1 : 0));
+}
+
+// In SVG the triangles are written from the farthest to the nearest
+// since a z-buffer cannot be used.
+void mesh3d::write_svg(svg_stream& s, int id, agg::rgba8 c, double h)
+{
+    const unsigned nt = triangles_number();
+    agg::pod_array<depth_order> order(nt);
+    unsigned n = 0;
+    for (unsigned t = 0; t < nt; t++) {
+        if (!triangle_visible(t))
+            continue;
+        const unsigned* tri = m_triangles.data() + 3 * t;
+        order[n].inv_depth = m_inv_depth[tri[0]] + m_inv_depth[tri[1]] + m_inv_depth[tri[2]];
+        order[n].index = t;
+        n++;
+    }
+    qsort(order.data(), n, sizeof(depth_order), depth_order_cmp);
+
+    if (id >= 0)
+        s.printf("<g id=\"path%i\">", id);
+    else
+        s.write("<g>");
+    for (unsigned j = 0; j < n; j++) {
+        const unsigned t = order[j].index;
+        const unsigned* tri = m_triangles.data() + 3 * t;
+        svg_path_begin(s);
+        svg_path_coords path(s);
+        for (int i = 0; i < 3; i++) {
+            const double x = m_screen[2 * tri[i]], y = svg_y_coord(m_screen[2 * tri[i] + 1], h);
+            if (i == 0)
+                path.move_to(x, y);
+            else
+                path.line_to(x, y);
+        }
+        path.close();
+        path.end();
+        if (m_edges)
+            svg_fill_stroke_path_end(s, 0.5, -1, triangle_color(t, c), m_edge_color);
+        else
+            svg_fill_path_end(s, -1, triangle_color(t, c));
+    }
+    s.write("</g>\n");
+}
+}
@@ -0,0 +1,84 @@
+#ifndef AGGPLOT_MESH3D_H
+#define AGGPLOT_MESH3D_H
+
+#include "agg_basics.h"
+#include "agg_array.h"
+#include "agg_trans_affine.h"
+#include "agg_color_rgba.h"
+
+#include "sg_object.h"
+
+namespace draw {
+
+// Surface in 3D given by a vertex buffer with the (x, y, z) coordinates
+// and by an index buffer with three vertices for each triangle, starting
+// from zero. The mesh is rotated around its center, projected with a
+// perspective camera and the triangles are rasterized directly in the
+// canvas with a z-buffer and flat shading. The vertices given by the
+// object, used for the SVG output or for a stroke, are the edges of the
+// projected triangles.
+class mesh3d : public sg_object
+{
+public:
+    mesh3d(unsigned nv, unsigned nt);
+
+    double* vertices() { return m_vertices.data(); }
+    unsigned* triangles() { return m_triangles.data(); }
+
+    unsigned vertices_number() const { return m_vertices.size() / 3; }
+    unsigned triangles_number() const { return m_triangles.size() / 3; }
+
+    // Should be called after the buffers are modified. Return false if
+    // the index buffer refers to a vertex that does not exist.
+    bool update();
+
+    // The rotations are applied around the z, x and y axis in this order.
+    void view(double rx, double ry, double rz);
+
+    void back_color(agg::rgba8 c) { m_back_color = c; }
+    void edge_color(agg::rgba8 c) { m_edge_color = c; m_edges = true; }
+    void edges_disable() { m_edges = false; }
+
+    virtual void rewind(unsigned path_id);
+    virtual unsigned vertex(double* x, double* y);
+
+    virtual void apply_transform(const agg::trans_affine& m, double as);
+    virtual void bounding_box(double *x1, double *y1, double *x2, double *y2);
+
+    virtual const sg_image* rasterize(const agg::rect_i& clip, agg::rgba8 c);
+    virtual void write_svg(svg_stream& s, int id, agg::rgba8 c, double h);
+
+private:
+    // Camera coordinates of the vertex k, the camera looks toward the
+    // negative z.
+    void view_coords(unsigned k, double* x, double* y, double* z) const;
+
+    bool triangle_visible(unsigned t) const;
+    agg::rgba8 triangle_color(unsigned t, agg::rgba8 c) const;
+
+    agg::pod_array<double> m_vertices;
+    agg::pod_array<unsigned> m_triangles;
+
+    double m_center[3];
+    double m_radius;
+    double m_distance;
+    double m_rot[9];
+
+    agg::rgba8 m_back_color;
+    agg::rgba8 m_edge_color;
+    bool m_edges;
+
+    // Projected vertices in pixels with the inverse of the depth, zero
+    // for the vertices that cannot be shown.
+    agg::pod_array<double> m_screen;
+    agg::pod_array<float> m_inv_depth;
+
+    agg::pod_array<agg::rgba8> m_pixels;
+    agg::pod_array<float> m_zbuffer;
+    sg_image m_image;
+
+    unsigned m_vertex_index;
+};
+}
+
+#endif
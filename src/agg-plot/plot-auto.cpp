@@ -44,7 +44,20 @@ void plot_auto::calc_bounding_box()
     unsigned n = this->nb_layers();
     for (unsigned j = 0; j < n-1; j++)
     {
-        box.add<rect_union>(this->get_layer(j)->bounding_box());
+        item_list* layer = this->get_layer(j);
+        box.add<rect_union>(layer->bounding_box());
+
+        // the incremental objects can grow after the layer was pushed
+        for (unsigned k = 0; k < layer->size(); k++)
+        {
+            item& d = (*layer)[k];
+            if (d.vs->incremental())
+            {
+                agg::rect_base<double> r;
+                d.vs->bounding_box(&r.x1, &r.y1, &r.x2, &r.y2);
+                box.add<rect_union>(r);
+            }
+        }
     }
 
     calc_layer_bounding_box(this->get_layer(n-1), box);
@@ -71,6 +84,31 @@ bool plot_auto::fit_inside(sg_object* obj) const
     return bb.hit_test(r.x1, r.y1) && bb.hit_test(r.x2, r.y2);
 }
 
+// The limits are computed again only if the object does not fit inside
+// them or if some part of it was removed. The plot needs to be redrawn
+// only if the area shown or the axis labels change.
+bool plot_auto::incremental_update_limits(sg_object* obj, bool removed)
+{
+    if (!removed && this->fit_inside(obj))
+        return false;
+
+    const agg::trans_affine trans = this->m_trans;
+    int xi, xs, yi, ys;
+    double xd, yd;
+    this->m_ux.limits(xi, xs, xd);
+    this->m_uy.limits(yi, ys, yd);
+
+    this->check_bounding_box();
+
+    int nxi, nxs, nyi, nys;
+    double nxd, nyd;
+    this->m_ux.limits(nxi, nxs, nxd);
+    this->m_uy.limits(nyi, nys, nyd);
+
+    const bool same_units = (xi == nxi && xs == nxs && xd == nxd && yi == nyi && ys == nys && yd == nyd);
+    return !(same_units && trans.is_equal(this->m_trans, 0.0));
+}
+
 void plot_auto::set_opt_limits(const opt_rect<double>& r)
 {
     if (r.is_defined())
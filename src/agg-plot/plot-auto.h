@@ -47,6 +47,9 @@ public:
     virtual bool pop_layer();
     virtual void clear_current_layer();
 
+protected:
+    virtual bool incremental_update_limits(sg_object* obj, bool removed);
+
 private:
     void calc_layer_bounding_box(item_list* layer, opt_rect<double>& rect);
     void set_opt_limits(const opt_rect<double>& r);
@@ -20,10 +20,38 @@ std_line_width(double scale, double w = 1.0)
 void plot::commit_pending_draw()
 {
     push_drawing_queue();
+    for (unsigned k = 0; k < m_layers.size(); k++)
+    {
+        item_list& layer = *(m_layers[k]);
+        for (unsigned j = 0; j < layer.size(); j++)
+        {
+            sg_incremental* inc = layer[j].vs->incremental();
+            if (inc)
+                inc->commit();
+        }
+    }
     m_need_redraw = false;
     m_changes_pending.clear();
 }
 
+void plot::update_incremental_limits()
+{
+    for (unsigned k = 0; k < m_layers.size(); k++)
+    {
+        item_list& layer = *(m_layers[k]);
+        for (unsigned j = 0; j < layer.size(); j++)
+        {
+            sg_object* vs = layer[j].vs;
+            sg_incremental* inc = vs->incremental();
+            if (!inc || !(inc->has_pending() || inc->redraw_needed()))
+                continue;
+            const bool removed = inc->redraw_needed();
+            if (incremental_update_limits(vs, removed) || removed)
+                m_need_redraw = true;
+        }
+    }
+}
+
 void plot::add(sg_object* vs, agg::rgba8& color, bool outline)
 {
     item d(vs, color, outline);
@@ -63,15 +91,69 @@ static bool area_is_valid(const agg::trans_affine& b)
 void plot::draw_virtual_canvas(canvas_type& canvas, plot_layout& layout, const agg::rect_i* clip)
 {
     before_draw();
-    draw_legends(canvas, layout);
+    {
+        render_timer timer(&m_stats, render_stats::legends);
+        draw_legends(canvas, layout);
+    }
 
     if (area_is_valid(layout.plot_area))
     {
-        draw_axis(canvas, layout, clip);
-        draw_elements(canvas, layout);
+        {
+            render_timer timer(&m_stats, render_stats::axis);
+            draw_axis(canvas, layout, clip);
+        }
+        {
+            render_timer timer(&m_stats, render_stats::elements);
+            draw_elements(canvas, layout);
+        }
+        if (m_stats_overlay)
+            draw_stats_overlay(canvas, layout);
     }
 };
 
+// Write on the top left corner of the plot area the stats of the
+// previous frame since the current one is not complete.
+void plot::draw_stats_overlay(canvas_type& canvas, const plot_layout& layout)
+{
+    const render_stats::counters& st = m_stats.previous_frame();
+    const render_stats::timer_e timers[] = {
+        render_stats::draw, render_stats::legends, render_stats::axis,
+        render_stats::elements, render_stats::queue
+    };
+    const double text_size = 12.0;
+
+    char line[256];
+    int len = 0;
+    line[0] = 0;
+    for (unsigned k = 0; k < sizeof(timers) / sizeof(timers[0]); k++)
+    {
+        const render_stats::timer_e t = timers[k];
+        if (st.time[t] <= 0.0 || len >= int(sizeof(line)) - 32)
+            continue;
+        len += snprintf(line + len, sizeof(line) - len, "%s%s %.2f ms",
+                        len > 0 ? ", " : "", render_stats::timer_name(t), st.time[t] * 1000.0);
+    }
+
+    const agg::trans_affine& m = layout.plot_active_area;
+    const double x = m.tx + 4.0, y = m.ty + m.sy - 4.0;
+
+    this->clip_plot_area(canvas, m);
+
+    draw::text times(line, text_size, 0.0, 1.0);
+    times.set_point(x, y);
+    times.apply_transform(identity_matrix, 1.0);
+    canvas.draw(times, colors::black);
+
+    snprintf(line, sizeof(line), "%llu vertices, %llu scanlines",
+             (unsigned long long) st.vertices, (unsigned long long) st.scanlines);
+    draw::text counts(line, text_size, 0.0, 1.0);
+    counts.set_point(x, y - times.text_height() * 1.2);
+    counts.apply_transform(identity_matrix, 1.0);
+    canvas.draw(counts, colors::black);
+
+    canvas.reset_clipping();
+}
+
 void plot::draw_simple(canvas_type& canvas, plot_layout& layout, const agg::rect_i* clip)
 {
     before_draw();
@@ -106,21 +188,90 @@ void plot::clip_plot_area(canvas_type& canvas, const agg::trans_affine& area_mtx
     }
 }
 
+void plot::draw_layer(item_list& layer, canvas_type& canvas, const agg::trans_affine& m)
+{
+    for (unsigned j = 0; j < layer.size(); j++)
+    {
+        // the part of the incremental objects added since the last
+        // update is drawn by draw_queue, unless all is drawn now
+        sg_incremental* inc = (m_draw_pending ? 0 : layer[j].vs->incremental());
+        if (inc)
+            inc->draw_mode(sg_incremental::draw_committed);
+        draw_element(layer[j], canvas, m);
+        if (inc)
+            inc->draw_mode(sg_incremental::draw_all);
+    }
+}
+
+// The image of the layers below the current one can be retained only if
+// they are clipped to the plot area and do not contain objects that grow
+// after they are drawn.
+bool plot::layers_cache_enabled()
+{
+    if (m_layers.size() < 2 || !m_clip_flag)
+        return false;
+
+    for (unsigned k = 0; k < m_layers.size() - 1; k++)
+    {
+        item_list& layer = *(m_layers[k]);
+        for (unsigned j = 0; j < layer.size(); j++)
+        {
+            if (layer[j].vs->incremental())
+                return false;
+        }
+    }
+    return true;
+}
+
+unsigned plot::lower_layers_modifications()
+{
+    unsigned count = 0;
+    for (unsigned k = 0; k + 1 < m_layers.size(); k++)
+    {
+        item_list& layer = *(m_layers[k]);
+        for (unsigned j = 0; j < layer.size(); j++)
+            count += layer[j].vs->modifications();
+    }
+    return count;
+}
+
 void plot::draw_elements(canvas_type& canvas, const plot_layout& layout)
 {
     const agg::trans_affine m = get_model_matrix(layout);
 
     this->clip_plot_area(canvas, layout.plot_active_area);
 
-    for (unsigned k = 0; k < m_layers.size(); k++)
+    unsigned k = 0;
+    if (layers_cache_enabled())
     {
-        item_list& layer = *(m_layers[k]);
-        for (unsigned j = 0; j < layer.size(); j++)
+        const unsigned top = m_layers.size() - 1;
+        const agg::rect_i area = rect_of_slot_matrix<int>(layout.plot_active_area);
+        const unsigned mods = lower_layers_modifications();
+
+        if (m_layers_cache.match(m, area, m_layers_generation, mods) &&
+            canvas.restore_area(m_layers_cache.image))
+        {
+            k = top;
+        }
+        else
         {
-            draw_element(layer[j], canvas, m);
+            for (/* */; k < top; k++)
+                draw_layer(*(m_layers[k]), canvas, m);
+
+            if (canvas.save_area(area, m_layers_cache.image))
+            {
+                m_layers_cache.matrix = m;
+                m_layers_cache.area = area;
+                m_layers_cache.generation = m_layers_generation;
+                m_layers_cache.modifications = mods;
+                m_layers_cache.valid = true;
+            }
         }
     }
 
+    for (/* */; k < m_layers.size(); k++)
+        draw_layer(*(m_layers[k]), canvas, m);
+
     canvas.reset_clipping();
 }
 
@@ -159,6 +310,7 @@ void plot::compute_user_trans()
     double dx = r.x2 - r.x1, dy = r.y2 - r.y1;
     double fx = (dx == 0 ? 1.0 : 1/dx), fy = (dy == 0 ? 1.0 : 1/dy);
     this->m_trans = agg::trans_affine(fx, 0.0, 0.0, fy, -r.x1 * fx, -r.y1 * fy);
+    m_layers_generation++;
 }
 
 void plot::draw_grid(const axis_e dir, const units& u,
@@ -693,6 +845,7 @@ bool plot::push_layer()
         before_draw();
         push_drawing_queue();
         m_layers.add(new_layer);
+        m_layers_generation++;
         return true;
     }
 
@@ -712,6 +865,7 @@ bool plot::pop_layer()
 
     clear_drawing_queue();
     m_need_redraw = true;
+    m_layers_generation++;
 
     return true;
 }
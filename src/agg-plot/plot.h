@@ -27,6 +27,7 @@
 #include "list.h"
 #include "strpp.h"
 #include "canvas.h"
+#include "render_stats.h"
 #include "units.h"
 #include "resource-manager.h"
 #include "colors.h"
@@ -68,6 +69,13 @@ public:
         m_canvas->reset_clipping();
     }
 
+    virtual bool save_area(const agg::rect_i& r, canvas_image& img) {
+        return m_canvas->save_area(r, img);
+    }
+    virtual bool restore_area(const canvas_image& img) {
+        return m_canvas->restore_area(img);
+    }
+
 private:
     Canvas* m_canvas;
 };
@@ -239,10 +247,10 @@ public:
 
     plot(bool use_units = true) :
         m_drawing_queue(0), m_clip_flag(true),
-        m_need_redraw(true), m_rect(),
+        m_need_redraw(true), m_draw_pending(false), m_rect(),
         m_use_units(use_units), m_pad_units(false), m_title(),
         m_sync_mode(true), m_x_axis(x_axis), m_y_axis(y_axis),
-        m_xaxis_hol(0)
+        m_xaxis_hol(0), m_layers_generation(0), m_stats_overlay(false)
     {
         m_layers.add(&m_root_layer);
         compute_user_trans();
@@ -312,6 +320,7 @@ public:
     {
         delete m_xaxis_hol;
         m_xaxis_hol = hol;
+        m_layers_generation++;
     }
 
     virtual void add(sg_object* vs, agg::rgba8& color, bool outline);
@@ -327,29 +336,55 @@ public:
             bb = agg::rect_base<double>(0.0, 0.0, 0.0, 0.0);
     }
 
+    // When "pending" is false the incremental objects draw only the part
+    // committed by the last update, the rest being drawn by draw_queue
+    // during the refresh of a window. It should be true when the plot is
+    // drawn by itself, for example to save it in a file, and in this case
+    // the limits are also updated for the points not yet committed.
     template <class Canvas>
-    void draw(Canvas& canvas, const agg::trans_affine& m, plot_render_info* inf)
+    void draw(Canvas& canvas, const agg::trans_affine& m, plot_render_info* inf, bool pending = false)
     {
+        render_timer timer(&m_stats, render_stats::draw);
+        canvas.stats(&m_stats);
         canvas_adapter<Canvas> vc(&canvas);
         agg::rect_i clip = rect_of_slot_matrix<int>(m);
+        if (pending)
+            update_incremental_limits();
         plot_layout layout = compute_plot_layout(m);
+        m_draw_pending = pending;
         draw_virtual_canvas(vc, layout, &clip);
+        m_draw_pending = false;
+        canvas.stats(0);
         if (inf)
             inf->active_area = layout.plot_active_area;
     }
 
     template <class Canvas>
-    void draw(Canvas& canvas, const agg::rect_i& r, plot_render_info* inf)
+    void draw(Canvas& canvas, const agg::rect_i& r, plot_render_info* inf, bool pending = false)
     {
+        render_timer timer(&m_stats, render_stats::draw);
+        canvas.stats(&m_stats);
         canvas_adapter<Canvas> vc(&canvas);
         agg::trans_affine mtx = affine_matrix(r);
+        if (pending)
+            update_incremental_limits();
         plot_layout layout = compute_plot_layout(mtx);
+        m_draw_pending = pending;
         draw_virtual_canvas(vc, layout, &r);
+        m_draw_pending = false;
+        canvas.stats(0);
         if (inf)
             inf->active_area = layout.plot_active_area;
     }
 
     virtual bool push_layer();
+
+    // The frames of the stats are started by the windows at each refresh
+    // so that a frame includes both the draw and the draw_queue calls.
+    render_stats& stats() { return m_stats; }
+
+    bool stats_overlay() const { return m_stats_overlay; }
+    void set_stats_overlay(bool flag) { m_stats_overlay = flag; }
     virtual bool pop_layer();
     virtual void clear_current_layer();
 
@@ -363,6 +398,7 @@ public:
     };
     void set_clip_mode(bool flag) {
         m_clip_flag = flag;
+        m_layers_generation++;
     };
 
     bool need_redraw() const {
@@ -370,6 +406,19 @@ public:
     };
     void commit_pending_draw();
 
+    // Update the limits for the points added to the incremental objects
+    // since the last update. The plot needs to be redrawn if the limits
+    // change or if some points already drawn were removed.
+    void update_incremental_limits();
+
+    // The layers below the current one will be drawn again instead of
+    // using their retained image. The changes made to the objects they
+    // contain are detected by their modifications count, this is used
+    // when the layers may have changed otherwise.
+    void discard_layers_cache() {
+        m_layers_generation++;
+    }
+
     template <class Canvas>
     void draw_queue(Canvas& canvas, const agg::trans_affine& m, const plot_render_info& inf, opt_rect<double>& bbox);
 
@@ -411,6 +460,7 @@ public:
 
     void enable_categories(axis_e dir) {
         get_axis(dir).use_categories = true;
+        m_layers_generation++;
     }
 
     void disable_categories(axis_e dir)
@@ -418,12 +468,14 @@ public:
         axis& ax = get_axis(dir);
         ax.use_categories = false;
         ax.categories.clear();
+        m_layers_generation++;
     }
 
     void add_category_entry(axis_e dir, double v, const char* text)
     {
         axis& ax = get_axis(dir);
         ax.categories.add_item(v, text);
+        m_layers_generation++;
     }
 
 protected:
@@ -444,10 +496,14 @@ protected:
                              agg::path_storage& mark, agg::path_storage& ln);
 
     void draw_elements(canvas_type &canvas, const plot_layout& layout);
+    void draw_layer(item_list& layer, canvas_type &canvas, const agg::trans_affine& m);
     void draw_element(item& c, canvas_type &canvas, const agg::trans_affine& m);
+    bool layers_cache_enabled();
+    unsigned lower_layers_modifications();
     void draw_axis(canvas_type& can, plot_layout& layout, const agg::rect_i* clip = 0);
 
     void draw_legends(canvas_type& canvas, const plot_layout& layout);
+    void draw_stats_overlay(canvas_type& canvas, const plot_layout& layout);
 
     plot_layout compute_plot_layout(const agg::trans_affine& canvas_mtx, bool do_legends = true);
 
@@ -461,6 +517,13 @@ protected:
 
     bool fit_inside(sg_object *obj) const;
 
+    // Called for the incremental objects that changed since the last
+    // update, "removed" is true if some part already drawn was removed.
+    // Return true if the limits of the plot change.
+    virtual bool incremental_update_limits(sg_object* obj, bool removed) {
+        return false;
+    }
+
     void layer_dispose_elements (item_list* layer);
 
     unsigned nb_layers() const {
@@ -486,6 +549,7 @@ protected:
     bool m_clip_flag;
 
     bool m_need_redraw;
+    bool m_draw_pending;
     opt_rect<double> m_rect;
 
     // keep trace of the region where changes happened since
@@ -510,11 +574,42 @@ private:
     plot* m_legend[4];
 
     ptr_list<factor_labels>* m_xaxis_hol;
+
+    // Image of the plot area with the axis and the layers below the
+    // current one. It is used in place of drawing them again while the
+    // model matrix is the same and the generation of the layers, that is
+    // incremented each time they or the axis change, is the same. The
+    // total count of the modifications of the objects in the layers
+    // should be the same too.
+    struct layers_cache {
+        canvas_image image;
+        agg::trans_affine matrix;
+        agg::rect_i area;
+        unsigned generation;
+        unsigned modifications;
+        bool valid;
+
+        layers_cache(): valid(false) { }
+
+        bool match(const agg::trans_affine& m, const agg::rect_i& r, unsigned gen, unsigned mods) const
+        {
+            return valid && generation == gen && modifications == mods && matrix.is_equal(m, 0.0) &&
+                area.x1 == r.x1 && area.y1 == r.y1 && area.x2 == r.x2 && area.y2 == r.y2;
+        }
+    };
+
+    layers_cache m_layers_cache;
+    unsigned m_layers_generation;
+
+    render_stats m_stats;
+    bool m_stats_overlay;
 };
 
 template <class Canvas>
 void plot::draw_queue(Canvas& _canvas, const agg::trans_affine& canvas_mtx, const plot_render_info& inf, opt_rect<double>& bb)
 {
+    render_timer timer(&m_stats, render_stats::queue);
+    _canvas.stats(&m_stats);
     canvas_adapter<Canvas> canvas(&_canvas);
     before_draw();
 
@@ -538,6 +633,31 @@ void plot::draw_queue(Canvas& _canvas, const agg::trans_affine& canvas_mtx, cons
             bb.add<rect_union>(ebb);
     }
 
+    // The incremental objects already in the plot draw only the part
+    // added since the last update.
+    for (unsigned k = 0; k < m_layers.size(); k++)
+    {
+        item_list& layer = *(m_layers[k]);
+        for (unsigned j = 0; j < layer.size(); j++)
+        {
+            item& d = layer[j];
+            sg_incremental* inc = d.vs->incremental();
+            if (!inc || !inc->has_pending())
+                continue;
+
+            inc->draw_mode(sg_incremental::draw_pending);
+            agg::trans_affine m = get_model_matrix(layout);
+            draw_element(d, canvas, m);
+
+            agg::rect_base<double> ebb;
+            bool not_empty = agg::bounding_rect_single(d.content(), 0, &ebb.x1, &ebb.y1, &ebb.x2, &ebb.y2);
+            inc->draw_mode(sg_incremental::draw_all);
+
+            if (not_empty)
+                bb.add<rect_union>(ebb);
+        }
+    }
+
     m_changes_accu.add<rect_union>(bb);
 
     if (m_changes_pending.is_defined())
@@ -546,6 +666,7 @@ void plot::draw_queue(Canvas& _canvas, const agg::trans_affine& canvas_mtx, cons
     }
 
     canvas.reset_clipping();
+    _canvas.stats(0);
 }
 
 #endif
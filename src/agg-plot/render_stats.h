@@ -0,0 +1,124 @@
+#ifndef AGGPLOT_RENDER_STATS_H
+#define AGGPLOT_RENDER_STATS_H
+
+#include <chrono>
+
+#include "agg_basics.h"
+
+// Counters of the time spent in each phase of the rendering and of the
+// vertices and scanlines given to the rasterizer. The counters are kept
+// both for the current frame and summed over all the frames.
+class render_stats {
+public:
+    enum timer_e {
+        // phases of the drawing of a plot
+        draw, legends, axis, elements, queue,
+        // phases of the refresh of a window
+        render, update_region, lock_wait,
+        timers_number
+    };
+
+    struct counters {
+        double time[timers_number]; // seconds
+        agg::int64u vertices, scanlines;
+
+        void clear()
+        {
+            for (int k = 0; k < timers_number; k++)
+                time[k] = 0.0;
+            vertices = scanlines = 0;
+        }
+    };
+
+    render_stats() { clear(); }
+
+    void clear()
+    {
+        m_total.clear();
+        m_frame.clear();
+        m_previous.clear();
+        m_frames = 0;
+    }
+
+    void frame_begin()
+    {
+        m_previous = m_frame;
+        m_frame.clear();
+        m_frames++;
+    }
+
+    void add_time(timer_e t, double s)
+    {
+        m_frame.time[t] += s;
+        m_total.time[t] += s;
+    }
+
+    void add_vertices(agg::int64u n)
+    {
+        m_frame.vertices += n;
+        m_total.vertices += n;
+    }
+
+    void add_scanlines(agg::int64u n)
+    {
+        m_frame.scanlines += n;
+        m_total.scanlines += n;
+    }
+
+    // Add the vertices and scanlines counted in a frame of other stats,
+    // like the ones of a plot drawn in a window, since they had the
+    // counters "since".
+    void add_counts(const counters& c, const counters& since)
+    {
+        add_vertices(c.vertices - since.vertices);
+        add_scanlines(c.scanlines - since.scanlines);
+    }
+
+    unsigned frames() const { return m_frames; }
+    const counters& total() const { return m_total; }
+    const counters& frame() const { return m_frame; }
+    const counters& previous_frame() const { return m_previous; }
+
+    static const char* timer_name(timer_e t)
+    {
+        static const char* names[timers_number] = {
+            "draw", "legends", "axis", "elements", "queue",
+            "render", "update_region", "lock_wait"
+        };
+        return names[t];
+    }
+
+private:
+    counters m_total, m_frame, m_previous;
+    unsigned m_frames;
+};
+
+// Add the time elapsed from its construction to its destruction to a
+// timer of the stats. Nothing is done if the stats are null.
+class render_timer {
+    typedef std::chrono::steady_clock clock;
+
+public:
+    render_timer(render_stats* stats, render_stats::timer_e t):
+        m_stats(stats), m_timer(t)
+    {
+        if (m_stats)
+            m_start = clock::now();
+    }
+
+    ~render_timer()
+    {
+        if (m_stats)
+        {
+            std::chrono::duration<double> dt = clock::now() - m_start;
+            m_stats->add_time(m_timer, dt.count());
+        }
+    }
+
+private:
+    render_stats* m_stats;
+    render_stats::timer_e m_timer;
+    clock::time_point m_start;
+};
+
+#endif
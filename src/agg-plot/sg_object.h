@@ -40,9 +40,35 @@ struct vertex_source {
     virtual ~vertex_source() { }
 };
 
+// Image in rgba format placed in the pixel coordinates of the canvas.
+// The pixels are stored by rows starting from the row at "y".
+struct sg_image {
+    int x, y;
+    unsigned width, height;
+    const agg::rgba8* pixels;
+};
+
+// Interface of the objects that grow after they are added to a plot.
+// The plot draws only the part added since the last update unless some
+// part already drawn was removed. The draw mode selects the part given
+// by the vertices.
+struct sg_incremental {
+    enum draw_mode_e { draw_all, draw_committed, draw_pending };
+
+    virtual void draw_mode(draw_mode_e mode) = 0;
+    virtual bool has_pending() const = 0;
+    virtual bool redraw_needed() const = 0;
+    // Called when all the part added has been drawn.
+    virtual void commit() = 0;
+
+    virtual ~sg_incremental() { }
+};
+
 // Scalable Graphics Object
 struct sg_object : public vertex_source {
 
+    sg_object(): m_modifications(0) { }
+
     virtual void apply_transform(const agg::trans_affine& m, double as) = 0;
     virtual void bounding_box(double *x1, double *y1, double *x2, double *y2) = 0;
 
@@ -50,20 +76,45 @@ struct sg_object : public vertex_source {
         return false;
     }
 
-    virtual str write_svg(int id, agg::rgba8 c, double h) {
-        str path;
-        svg_property_list* ls = this->svg_path(path, h);
-        str s = svg_fill_path(path, id, c, ls);
+    virtual void write_svg(svg_stream& s, int id, agg::rgba8 c, double h) {
+        svg_path_begin(s);
+        svg_property_list* ls = this->svg_path(s, h);
+        svg_fill_path_end(s, id, c, ls);
         svg_property_list::free(ls);
-        return s;
     }
 
-    virtual svg_property_list* svg_path(str& s, double h) {
+    virtual svg_property_list* svg_path(svg_stream& s, double h) {
         svg_coords_from_vs(this, s, h);
         return 0;
     }
 
+    // The objects that perform their own rasterization return the image
+    // to be blended in the canvas, limited to the clipping box, instead
+    // of the path given by the vertices.
+    virtual const sg_image* rasterize(const agg::rect_i& clip, agg::rgba8 c) {
+        return 0;
+    }
+
+    virtual sg_incremental* incremental() {
+        return 0;
+    }
+
+    // Should be called when the object is changed, it may be already
+    // drawn in a plot.
+    void modified() {
+        m_modifications++;
+    }
+
+    // Number of the changes of the object and of its sources. The plots
+    // use it to know when the retained image of a layer is stale.
+    virtual unsigned modifications() {
+        return m_modifications;
+    }
+
     virtual ~sg_object() { }
+
+private:
+    unsigned m_modifications;
 };
 
 struct approx_scale {
@@ -152,6 +203,20 @@ public:
         this->m_source->bounding_box(x1, y1, x2, y2);
     }
 
+    virtual sg_incremental* incremental() {
+        return this->m_source->incremental();
+    }
+
+    virtual unsigned modifications() {
+        return this->m_source->modifications();
+    }
+
+    // The conversion changes the geometry of the source so the path given
+    // by the vertices is drawn even if the source rasterizes itself.
+    virtual const sg_image* rasterize(const agg::rect_i& clip, agg::rgba8 c) {
+        return 0;
+    }
+
     const ConvType& self() const {
         return m_output;
     };
@@ -194,9 +259,21 @@ public:
         m_source->apply_transform (m, as * m.scale());
     }
 
+    // The incremental objects keep their bounding box updated.
     virtual void bounding_box(double *x1, double *y1, double *x2, double *y2)
     {
-        agg::bounding_rect_single (*m_source, 0, x1, y1, x2, y2);
+        if (m_source->incremental())
+            m_source->bounding_box(x1, y1, x2, y2);
+        else
+            agg::bounding_rect_single (*m_source, 0, x1, y1, x2, y2);
+    }
+
+    virtual sg_incremental* incremental() {
+        return m_source->incremental();
+    }
+
+    virtual unsigned modifications() {
+        return m_source->modifications();
     }
 };
 
@@ -228,18 +305,32 @@ public:
         this->m_source->bounding_box(x1, y1, x2, y2);
     }
 
-    virtual str write_svg(int id, agg::rgba8 c, double h) {
-        return this->m_source->write_svg(id, c, h);
+    virtual void write_svg(svg_stream& s, int id, agg::rgba8 c, double h) {
+        this->m_source->write_svg(s, id, c, h);
     }
 
-    virtual svg_property_list* svg_path(str& s, double h) {
+    virtual svg_property_list* svg_path(svg_stream& s, double h) {
         return this->m_source->svg_path(s, h);
     }
 
+    // The reference adds no geometry, it is the only wrapper that lets
+    // the source rasterize itself.
+    virtual const sg_image* rasterize(const agg::rect_i& clip, agg::rgba8 c) {
+        return this->m_source->rasterize(clip, c);
+    }
+
     virtual bool affine_compose(agg::trans_affine& m) {
         return this->m_source->affine_compose(m);
     }
 
+    virtual sg_incremental* incremental() {
+        return this->m_source->incremental();
+    }
+
+    virtual unsigned modifications() {
+        return this->m_source->modifications();
+    }
+
 private:
     sg_object* m_source;
 };
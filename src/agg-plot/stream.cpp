@@ -0,0 +1,137 @@
+
+/* stream.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "stream.h"
+
+namespace draw {
+
+stream::stream(unsigned capacity):
+    m_x(capacity), m_y(capacity),
+    m_start(0), m_end(0), m_committed(0), m_redraw(false), m_window(0.0),
+    m_xmin(capacity, false), m_xmax(capacity, true),
+    m_ymin(capacity, false), m_ymax(capacity, true),
+    m_mode(draw_all), m_vertex(0), m_vertex_start(0), m_vertex_end(0)
+{
+}
+
+void stream::pop_front()
+{
+    if (m_start < m_committed)
+        m_redraw = true;
+    m_start++;
+    m_xmin.pop_before(m_start);
+    m_xmax.pop_before(m_start);
+    m_ymin.pop_before(m_start);
+    m_ymax.pop_before(m_start);
+}
+
+void stream::append(double x, double y)
+{
+    if (size() == capacity())
+        pop_front();
+
+    const unsigned k = unsigned(m_end % capacity());
+    m_x[k] = x;
+    m_y[k] = y;
+    m_xmin.push(m_end, x);
+    m_xmax.push(m_end, x);
+    m_ymin.push(m_end, y);
+    m_ymax.push(m_end, y);
+    m_end++;
+
+    if (m_window > 0.0)
+    {
+        while (m_x[unsigned(m_start % capacity())] < x - m_window)
+            pop_front();
+    }
+}
+
+void stream::clear()
+{
+    if (m_committed > m_start)
+        m_redraw = true;
+    m_start = m_end;
+    m_xmin.clear();
+    m_xmax.clear();
+    m_ymin.clear();
+    m_ymax.clear();
+}
+
+void stream::set_window(double w)
+{
+    m_window = w;
+    if (m_window > 0.0 && size() > 0)
+    {
+        const double x = m_x[unsigned((m_end - 1) % capacity())];
+        while (m_x[unsigned(m_start % capacity())] < x - m_window)
+            pop_front();
+    }
+}
+
+void stream::commit()
+{
+    m_committed = m_end;
+    m_redraw = false;
+}
+
+void stream::bounding_box(double *x1, double *y1, double *x2, double *y2)
+{
+    if (size() == 0)
+    {
+        *x1 = *y1 = 1.0;
+        *x2 = *y2 = 0.0;
+        return;
+    }
+    *x1 = m_xmin.extremum();
+    *y1 = m_ymin.extremum();
+    *x2 = m_xmax.extremum();
+    *y2 = m_ymax.extremum();
+}
+
+// The pending segments start from the last point already drawn so that
+// they are connected to the rest of the line.
+void stream::rewind(unsigned path_id)
+{
+    m_vertex_start = m_start;
+    m_vertex_end = m_end;
+    if (m_mode == draw_committed)
+    {
+        m_vertex_end = (m_committed > m_start ? m_committed : m_start);
+    }
+    else if (m_mode == draw_pending)
+    {
+        if (m_committed > m_start)
+            m_vertex_start = m_committed - 1;
+    }
+    m_vertex = m_vertex_start;
+}
+
+unsigned stream::vertex(double* x, double* y)
+{
+    if (m_vertex >= m_vertex_end)
+        return agg::path_cmd_stop;
+    const unsigned k = unsigned(m_vertex % capacity());
+    *x = m_x[k];
+    *y = m_y[k];
+    const bool first = (m_vertex == m_vertex_start);
+    m_vertex++;
+    return (first ? agg::path_cmd_move_to : agg::path_cmd_line_to);
+}
+}
@@ -0,0 +1,120 @@
+#ifndef AGGPLOT_STREAM_H
+#define AGGPLOT_STREAM_H
+
+#include "agg_basics.h"
+#include "agg_array.h"
+
+#include "sg_object.h"
+
+namespace draw {
+
+// Queue of the points that can become the minimum, or the maximum, of
+// the values in a sliding sequence. The values in the queue are
+// monotonic so the extremum is always the first element and each point
+// is added and removed once.
+class monotonic_queue {
+public:
+    monotonic_queue(unsigned capacity, bool maximum):
+        m_entries(capacity), m_head(0), m_size(0), m_maximum(maximum)
+    { }
+
+    void push(agg::int64u seq, double v)
+    {
+        while (m_size > 0 && dominates(v, back().value))
+            m_size--;
+        entry& e = m_entries[(m_head + m_size) % m_entries.size()];
+        e.seq = seq;
+        e.value = v;
+        m_size++;
+    }
+
+    // Remove the points that come before "seq".
+    void pop_before(agg::int64u seq)
+    {
+        while (m_size > 0 && m_entries[m_head].seq < seq)
+        {
+            m_head = (m_head + 1) % m_entries.size();
+            m_size--;
+        }
+    }
+
+    void clear() { m_head = m_size = 0; }
+
+    double extremum() const { return m_entries[m_head].value; }
+
+private:
+    struct entry {
+        agg::int64u seq;
+        double value;
+    };
+
+    const entry& back() const {
+        return m_entries[(m_head + m_size - 1) % m_entries.size()];
+    }
+
+    bool dominates(double a, double b) const {
+        return (m_maximum ? a >= b : a <= b);
+    }
+
+    agg::pod_array<entry> m_entries;
+    unsigned m_head, m_size;
+    bool m_maximum;
+};
+
+// Polyline stored in a ring buffer of fixed capacity. When the buffer is
+// full the oldest point is removed for each new point. In the sliding
+// window mode the points are also removed when their x coordinate is
+// more than the window behind the last point. The bounding box is kept
+// updated while the points are added and removed. Once the stream is
+// in a plot only the segments added after the last update are drawn,
+// unless some of the points already drawn were removed.
+class stream : public sg_object, public sg_incremental
+{
+public:
+    stream(unsigned capacity);
+
+    void append(double x, double y);
+    void clear();
+
+    // A window of zero disables the sliding window mode.
+    void set_window(double w);
+    double window() const { return m_window; }
+
+    unsigned capacity() const { return m_x.size(); }
+    unsigned size() const { return unsigned(m_end - m_start); }
+
+    virtual void rewind(unsigned path_id);
+    virtual unsigned vertex(double* x, double* y);
+
+    virtual void apply_transform(const agg::trans_affine& m, double as) { }
+    virtual void bounding_box(double *x1, double *y1, double *x2, double *y2);
+
+    virtual sg_incremental* incremental() { return this; }
+
+    virtual void draw_mode(draw_mode_e mode) { m_mode = mode; }
+    virtual bool has_pending() const { return m_end > m_committed; }
+    virtual bool redraw_needed() const { return m_redraw; }
+    virtual void commit();
+
+private:
+    void pop_front();
+
+    agg::pod_array<double> m_x, m_y;
+
+    // Sequence numbers of the first point and of the point after the last
+    // one. The point with sequence number k is stored at k % capacity.
+    agg::int64u m_start, m_end;
+    // Sequence number of the point after the last one drawn.
+    agg::int64u m_committed;
+    bool m_redraw;
+
+    double m_window;
+
+    monotonic_queue m_xmin, m_xmax, m_ymin, m_ymax;
+
+    draw_mode_e m_mode;
+    agg::int64u m_vertex, m_vertex_start, m_vertex_end;
+};
+}
+
+#endif
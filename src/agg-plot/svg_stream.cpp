@@ -0,0 +1,229 @@
+
+/* svg_stream.cpp
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "svg_stream.h"
+
+svg_stream::svg_stream(FILE* f, int decimals):
+    m_file(f), m_buffer(new char[buffer_size]), m_pos(0),
+    m_decimals(decimals), m_scale(pow(10.0, decimals)), m_tolerance(0.0)
+{ }
+
+svg_stream::~svg_stream()
+{
+    flush();
+    delete [] m_buffer;
+}
+
+void svg_stream::flush()
+{
+    if (m_pos > 0)
+        fwrite(m_buffer, 1, m_pos, m_file);
+    m_pos = 0;
+}
+
+void svg_stream::write(const char* s)
+{
+    unsigned len = strlen(s);
+    while (len > 0) {
+        if (m_pos == buffer_size)
+            flush();
+        unsigned n = buffer_size - m_pos;
+        if (n > len)
+            n = len;
+        memcpy(m_buffer + m_pos, s, n);
+        m_pos += n;
+        s += n;
+        len -= n;
+    }
+}
+
+void svg_stream::printf(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(m_buffer + m_pos, buffer_size - m_pos, fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return;
+    if (unsigned(n) < buffer_size - m_pos) {
+        m_pos += n;
+        return;
+    }
+
+    // the text did not fit in the space left: retry with the buffer
+    // flushed or write it directly to the file if it is too long.
+    flush();
+    va_start(ap, fmt);
+    if (unsigned(n) < buffer_size) {
+        vsnprintf(m_buffer, buffer_size, fmt, ap);
+        m_pos = n;
+    } else {
+        vfprintf(m_file, fmt, ap);
+    }
+    va_end(ap);
+}
+
+void svg_stream::coord(long long q)
+{
+    char digits[32];
+    int n = 0;
+    unsigned long long u = (q < 0 ? -(unsigned long long) q : q);
+
+    if (q < 0)
+        put('-');
+
+    // the digits are obtained in reverse order, the first m_decimals
+    // are the fractional part.
+    do {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u > 0 || n <= m_decimals);
+
+    int frac_start = 0;
+    while (frac_start < m_decimals && digits[frac_start] == '0')
+        frac_start++;
+
+    for (int k = n - 1; k >= m_decimals; k--)
+        put(digits[k]);
+
+    if (frac_start < m_decimals) {
+        put('.');
+        for (int k = m_decimals - 1; k >= frac_start; k--)
+            put(digits[k]);
+    }
+}
+
+svg_path_coords::svg_path_coords(svg_stream& s):
+    m_stream(s), m_x(0), m_y(0), m_start_x(0), m_start_y(0),
+    m_pending_x(0), m_pending_y(0), m_pending(false),
+    m_tolerance(s.simplify_tolerance() * s.resolution_scale()), m_cmd(0)
+{ }
+
+void svg_path_coords::command(char cmd)
+{
+    if (cmd != m_cmd) {
+        m_stream.put(cmd);
+        m_cmd = cmd;
+    } else {
+        m_stream.put(' ');
+    }
+}
+
+void svg_path_coords::pair(long long x, long long y)
+{
+    m_stream.coord(x);
+    m_stream.put(',');
+    m_stream.coord(y);
+}
+
+void svg_path_coords::emit_pending()
+{
+    if (m_pending) {
+        command('l');
+        pair(m_pending_x - m_x, m_pending_y - m_y);
+        m_x = m_pending_x;
+        m_y = m_pending_y;
+        m_pending = false;
+    }
+}
+
+void svg_path_coords::move_to(double x, double y)
+{
+    if (!isfinite(x) || !isfinite(y))
+        return;
+    emit_pending();
+    // the command is always repeated since the coordinates following
+    // a move_to are taken as a line_to.
+    m_stream.put('M');
+    m_cmd = 'M';
+    m_x = m_start_x = m_stream.quantize(x);
+    m_y = m_start_y = m_stream.quantize(y);
+    pair(m_x, m_y);
+}
+
+void svg_path_coords::line_to(double x, double y)
+{
+    if (!isfinite(x) || !isfinite(y))
+        return;
+    if (m_cmd == 0) {
+        move_to(x, y);
+        return;
+    }
+    const long long qx = m_stream.quantize(x), qy = m_stream.quantize(y);
+    if (m_tolerance > 0) {
+        const double dx = double(qx - m_x), dy = double(qy - m_y);
+        if (dx * dx + dy * dy < m_tolerance * m_tolerance) {
+            m_pending_x = qx;
+            m_pending_y = qy;
+            m_pending = true;
+            return;
+        }
+        m_pending = false;
+    }
+    command('l');
+    pair(qx - m_x, qy - m_y);
+    m_x = qx;
+    m_y = qy;
+}
+
+void svg_path_coords::curve3(double x1, double y1, double x, double y)
+{
+    if (!isfinite(x1) || !isfinite(y1) || !isfinite(x) || !isfinite(y))
+        return;
+    emit_pending();
+    const long long qx1 = m_stream.quantize(x1), qy1 = m_stream.quantize(y1);
+    const long long qx = m_stream.quantize(x), qy = m_stream.quantize(y);
+    command('q');
+    pair(qx1 - m_x, qy1 - m_y);
+    m_stream.put(' ');
+    pair(qx - m_x, qy - m_y);
+    m_x = qx;
+    m_y = qy;
+}
+
+void svg_path_coords::curve4(double x1, double y1, double x2, double y2, double x, double y)
+{
+    if (!isfinite(x1) || !isfinite(y1) || !isfinite(x2) || !isfinite(y2) || !isfinite(x) || !isfinite(y))
+        return;
+    emit_pending();
+    const long long qx1 = m_stream.quantize(x1), qy1 = m_stream.quantize(y1);
+    const long long qx2 = m_stream.quantize(x2), qy2 = m_stream.quantize(y2);
+    const long long qx = m_stream.quantize(x), qy = m_stream.quantize(y);
+    command('c');
+    pair(qx1 - m_x, qy1 - m_y);
+    m_stream.put(' ');
+    pair(qx2 - m_x, qy2 - m_y);
+    m_stream.put(' ');
+    pair(qx - m_x, qy - m_y);
+    m_x = qx;
+    m_y = qy;
+}
+
+void svg_path_coords::close()
+{
+    emit_pending();
+    m_stream.put('z');
+    m_cmd = 'z';
+    m_x = m_start_x;
+    m_y = m_start_y;
+}
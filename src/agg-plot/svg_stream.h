@@ -0,0 +1,85 @@
+#ifndef AGGPLOT_SVG_STREAM_H
+#define AGGPLOT_SVG_STREAM_H
+
+#include <stdio.h>
+#include <math.h>
+
+// Buffered writer used to produce the SVG files. The coordinates of the
+// paths are rounded to a fixed resolution and they are written directly
+// in the buffer without using printf.
+class svg_stream {
+public:
+    enum { buffer_size = 1 << 20 };
+
+    svg_stream(FILE* f, int decimals = 2);
+    ~svg_stream();
+
+    void put(char c) {
+        if (m_pos == buffer_size)
+            flush();
+        m_buffer[m_pos++] = c;
+    }
+
+    void write(const char* s);
+    void printf(const char* fmt, ...);
+    void flush();
+
+    // Convert a coordinate in integer units of the resolution.
+    long long quantize(double v) const {
+        const double lim = 1.0e12;
+        v = (v > lim ? lim : (v < -lim ? -lim : v));
+        return llround(v * m_scale);
+    }
+
+    // Write a coordinate given in units of the resolution using the
+    // shortest decimal representation.
+    void coord(long long q);
+
+    // The vertices of the paths closer than the tolerance, in user units,
+    // to the previous one are omitted. The tolerance is zero by default.
+    double simplify_tolerance() const { return m_tolerance; }
+    void simplify_tolerance(double tol) { m_tolerance = tol; }
+
+    double resolution_scale() const { return m_scale; }
+
+private:
+    svg_stream(const svg_stream&) = delete;
+    svg_stream& operator= (const svg_stream&) = delete;
+
+    FILE* m_file;
+    char* m_buffer;
+    unsigned m_pos;
+    int m_decimals;
+    double m_scale;
+    double m_tolerance;
+};
+
+// Write the "d" attribute of a path using relative coordinates. When
+// the simplification is enabled the vertices of a line too close to
+// the previous one are skipped except the last one of each subpath.
+class svg_path_coords {
+public:
+    svg_path_coords(svg_stream& s);
+
+    void move_to(double x, double y);
+    void line_to(double x, double y);
+    void curve3(double x1, double y1, double x, double y);
+    void curve4(double x1, double y1, double x2, double y2, double x, double y);
+    void close();
+    void end() { emit_pending(); }
+
+private:
+    void command(char cmd);
+    void pair(long long x, long long y);
+    void emit_pending();
+
+    svg_stream& m_stream;
+    long long m_x, m_y;
+    long long m_start_x, m_start_y;
+    long long m_pending_x, m_pending_y;
+    bool m_pending;
+    double m_tolerance;
+    char m_cmd;
+};
+
+#endif
@@ -46,7 +46,7 @@ public:
         m_bbox.y2 = ty + m_text_label.get_text_height() + pad;
     }
 
-    virtual str write_svg(int id, agg::rgba8 c, double h)
+    virtual void write_svg(svg_stream& s, int id, agg::rgba8 c, double h)
     {
         const str& text = m_text_label.text();
         double txt_size = m_size;
@@ -55,13 +55,11 @@ public:
 
         double x = m.tx, y = m.ty;
 
-        str s = str::print("<text x=\"%g\" y=\"%g\" id=\"text%i\"" \
-                           " style=\"font-size:%i\">" \
-                           " <tspan id=\"tspan%i\">%s</tspan>" \
-                           "</text>",
-                           x, svg_y_coord(y, h), id, int(txt_size), id, text.cstr());
-
-        return s;
+        s.printf("<text x=\"%g\" y=\"%g\" id=\"text%i\"" \
+                 " style=\"font-size:%i\">" \
+                 " <tspan id=\"tspan%i\">%s</tspan>" \
+                 "</text>",
+                 x, svg_y_coord(y, h), id, int(txt_size), id, text.cstr());
     }
 
     virtual void apply_transform(const agg::trans_affine& m, double as)
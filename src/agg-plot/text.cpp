@@ -24,17 +24,16 @@ text::bounding_box(double *x1, double *y1, double *x2, double *y2)
     *y1 = *y2 = m_y;
 }
 
-str
-text::write_svg(int id, agg::rgba8 c, double h)
+void
+text::write_svg(svg_stream& s, int id, agg::rgba8 c, double h)
 {
     const agg::trans_affine& m = m_matrix;
 
     const double eps = 1.0e-6;
-    str s;
 
     const str& content = m_text_label.text();
     if (str_is_null(&content))
-        return s;
+        return;
 
     str style;
     int hjust = lrint(m_hjustif * 2.0);
@@ -63,21 +62,21 @@ text::write_svg(int id, agg::rgba8 c, double h)
     }
 
     const char* cont = get_text();
-    str txt = str::print("<text x=\"%g\" y=\"%g\" id=\"text%i\""        \
-                         " style=\"font-size:%i%s\">"                        \
-                         " <tspan id=\"tspan%i\">%s</tspan>" \
-                         "</text>",
-                         x, y, id, txt_size, style.cstr(),
-                         id, cont);
 
     if (need_rotate) {
-        s = str::print("<g transform=\"matrix(%g,%g,%g,%g,%g,%g)\">%s</g>",
-                       m.sx, m.shx, m.shy, m.sy, m.tx, svg_y_coord(m.ty, h),
-                       txt.cstr());
-    } else {
-        s = txt;
+        s.printf("<g transform=\"matrix(%g,%g,%g,%g,%g,%g)\">",
+                 m.sx, m.shx, m.shy, m.sy, m.tx, svg_y_coord(m.ty, h));
     }
 
-    return s;
+    s.printf("<text x=\"%g\" y=\"%g\" id=\"text%i\""        \
+             " style=\"font-size:%i%s\">"                        \
+             " <tspan id=\"tspan%i\">%s</tspan>" \
+             "</text>",
+             x, y, id, txt_size, style.cstr(),
+             id, cont);
+
+    if (need_rotate) {
+        s.write("</g>");
+    }
 }
 }
@@ -9,6 +9,7 @@ extern "C" {
 #include "lua-plot-cpp.h"
 #include "lua-cpp-utils.h"
 #include "plot.h"
+#include "render_stats.h"
 #include "rect.h"
 #include "list.h"
 
@@ -59,6 +60,7 @@ public:
 
 private:
     void draw_slot_by_ref(ref& ref, bool dirty);
+    void agg_lock();
     void refresh_slot_by_ref(ref& ref, bool draw_all);
     void cleanup_tree_rec (lua_State *L, int window_index, ref::node* n);
 
@@ -68,6 +70,7 @@ private:
     void plot_apply_rec(Function& f, ref::node* n);
 
     ref::node* m_tree;
+    render_stats m_stats;
 
 public:
     window(gsl_shell_state* gs, agg::rgba8 bgcol= colors::white):
@@ -91,6 +94,10 @@ public:
 
     void draw_slot(int slot_id);
 
+    // Each call to draw_slot or on_draw is a frame of the stats, of the
+    // window and of the plots drawn.
+    render_stats& stats() { return m_stats; }
+
     virtual void on_draw();
     virtual void on_resize(int sx, int sy);
 
@@ -102,6 +109,10 @@ private:
         window* win;
     };
 
+    struct plot_frame_function {
+        void call(window::ref* ref) { if (ref->plot) ref->plot->stats().frame_begin(); }
+    };
+
     struct dispose_buffer_function {
         void call(window::ref* ref) { ref->dispose_buffer(); }
     };
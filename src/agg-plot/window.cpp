@@ -136,13 +136,27 @@ void window::draw_slot_by_ref(window::ref& ref, bool draw_image)
 
     if (ref.plot)
     {
-        AGG_LOCK();
-        ref.plot->draw(*m_canvas, mtx, &ref.inf);
+        agg_lock();
+        const render_stats::counters counts = ref.plot->stats().frame();
+        {
+            render_timer timer(&m_stats, render_stats::render);
+            ref.plot->draw(*m_canvas, mtx, &ref.inf);
+        }
+        m_stats.add_counts(ref.plot->stats().frame(), counts);
         AGG_UNLOCK();
     }
 
     if (draw_image)
+    {
+        render_timer timer(&m_stats, render_stats::update_region);
         update_region(r);
+    }
+}
+
+void window::agg_lock()
+{
+    render_timer timer(&m_stats, render_stats::lock_wait);
+    AGG_LOCK();
 }
 
 void
@@ -151,7 +165,13 @@ window::draw_slot(int slot_id, bool clean_req)
     ref *ref = window::ref_lookup (this->m_tree, slot_id);
     if (ref && m_canvas)
     {
+        m_stats.frame_begin();
+
+        agg_lock();
+        ref->plot->stats().frame_begin();
+        ref->plot->update_incremental_limits();
         bool redraw = clean_req || ref->plot->need_redraw();
+        AGG_UNLOCK();
 
         if (redraw)
         {
@@ -215,9 +235,14 @@ window::refresh_slot_by_ref(ref& ref, bool draw_all)
     if (!ref.valid_rect || draw_all)
         rect.set(rect_of_slot_matrix<double>(mtx));
 
-    AGG_LOCK();
+    agg_lock();
     opt_rect<double> draw_rect;
-    ref.plot->draw_queue(*m_canvas, mtx, ref.inf, draw_rect);
+    const render_stats::counters counts = ref.plot->stats().frame();
+    {
+        render_timer timer(&m_stats, render_stats::render);
+        ref.plot->draw_queue(*m_canvas, mtx, ref.inf, draw_rect);
+    }
+    m_stats.add_counts(ref.plot->stats().frame(), counts);
     rect.add<rect_union>(draw_rect);
     rect.add<rect_union>(ref.dirty_rect);
     ref.dirty_rect = draw_rect;
@@ -228,6 +253,7 @@ window::refresh_slot_by_ref(ref& ref, bool draw_all)
         const int m = 4;
         const agg::rect_base<double>& r = rect.rect();
         const agg::rect_base<int> ri(r.x1 - m, r.y1 - m, r.x2 + m, r.y2 + m);
+        render_timer timer(&m_stats, render_stats::update_region);
         update_region (ri);
     }
 }
@@ -237,6 +263,11 @@ window::on_draw()
 {
     if (m_canvas)
     {
+        m_stats.frame_begin();
+        plot_frame_function frame_func;
+        agg_lock();
+        this->plot_apply(frame_func);
+        AGG_UNLOCK();
         slot_draw_function draw_func(this);
         this->plot_apply(draw_func);
     }
@@ -487,6 +518,7 @@ window_split (lua_State *L)
     if (win->status == canvas_window::running)
     {
         win->on_draw();
+        render_timer timer(&win->stats(), render_stats::update_region);
         win->do_window_update();
     }
 
@@ -542,6 +574,7 @@ window_update (lua_State *L)
     if (win->status == canvas_window::running)
     {
         win->on_draw();
+        render_timer timer(&win->stats(), render_stats::update_region);
         win->do_window_update();
     }
     win->unlock();
@@ -561,6 +594,22 @@ window_restore_slot_image (lua_State *L)
     return window_generic_oper (L, &window::restore_slot_image);
 }
 
+int
+window_stats (lua_State *L)
+{
+    window *win = object_check<window>(L, 1, GS_WINDOW);
+    bool reset = lua_toboolean (L, 2);
+
+    win->lock();
+    render_stats stats = win->stats();
+    if (reset)
+        win->stats().clear();
+    win->unlock();
+
+    render_stats_push (L, stats);
+    return 1;
+}
+
 int
 window_close (lua_State *L)
 {
@@ -590,8 +639,8 @@ window_wait (lua_State *L)
 
 class svg_writer {
 public:
-    svg_writer(FILE* f, double w, double h):
-    m_canvas(f, h), m_width(w), m_height(h)
+    svg_writer(FILE* f, double w, double h, double tolerance):
+    m_canvas(f, h, tolerance), m_width(w), m_height(h)
     { }
 
     void write_header() { m_canvas.write_header(m_width, m_height); }
@@ -608,7 +657,7 @@ public:
             trans_affine_compose(mtx, scale);
             sprintf(plot_name, "plot%u", ref->slot_id + 1);
             m_canvas.write_group_header(plot_name);
-            p->draw(m_canvas, mtx, NULL);
+            p->draw(m_canvas, mtx, NULL, true);
             m_canvas.write_group_end(plot_name);
         }
     }
@@ -625,6 +674,7 @@ window_save_svg_try(lua_State *L)
     const char *filename = lua_tostring(L, 2);
     const double w = luaL_optnumber(L, 3, 600.0);
     const double h = luaL_optnumber(L, 4, 600.0);
+    const double tolerance = luaL_optnumber(L, 5, 0.0);
 
     if (!filename) return type_error_return(L, 2, "string");
 
@@ -643,7 +693,7 @@ window_save_svg_try(lua_State *L)
         return (-1);
     }
 
-    svg_writer svg_writer(f, w, h);
+    svg_writer svg_writer(f, w, h, tolerance);
     svg_writer.write_header();
     win->plot_apply(svg_writer);
     svg_writer.write_end();
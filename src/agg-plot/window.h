@@ -13,6 +13,7 @@ extern int  window_slot_update             (lua_State *L);
 extern int  window_slot_refresh            (lua_State *L);
 extern int  window_save_slot_image         (lua_State *L);
 extern int  window_restore_slot_image      (lua_State *L);
+extern int  window_stats                   (lua_State *L);
 extern int  window_update                  (lua_State *L);
 extern int  window_new                     (lua_State *L);
 extern int  window_show                    (lua_State *L);
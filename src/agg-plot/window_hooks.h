@@ -17,6 +17,7 @@ struct window_hooks {
     int (*wait)(lua_State* L);
     int (*save_image)(lua_State* L);
     int (*restore_image)(lua_State* L);
+    int (*stats)(lua_State* L);
 
     void (*register_module)(lua_State* L);
 };
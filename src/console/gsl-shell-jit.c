@@ -42,6 +42,7 @@
 #include "lualib.h"
 #include "luajit.h"
 #include "lua-filesystem.h"
+#include "lua-parallel.h"
 #include "lua-gsl.h"
 #include "gsl-shell.h"
 #include "completion.h"
@@ -114,7 +115,7 @@ struct window_hooks app_window_hooks[1] = {{
         window_slot_update, window_slot_refresh,
         window_close_wait, window_wait,
         window_save_slot_image, window_restore_slot_image,
-        window_register,
+        window_stats, window_register,
     }
 };
 
@@ -125,6 +126,7 @@ static void gsl_shell_openlibs(lua_State *L)
         fprintf(stderr, "warning: running without graphics module\n");
     }
     luaopen_filesystem (L);
+    luaopen_parallel (L);
 }
 
 static void lstop(lua_State *L, lua_Debug *ar)
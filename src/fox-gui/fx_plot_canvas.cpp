@@ -23,6 +23,8 @@ void fx_plot_canvas::update_region(const agg::rect_i& r)
     FXshort ww = r.x2 - r.x1, hh= r.y2 - r.y1;
     if (ww <= 0 || hh <= 0) return;
 
+    render_timer timer(&m_surface->stats(), render_stats::update_region);
+
     const window_surface::image& src_img = m_surface->get_image();
 
     FXImage img(getApp(), NULL, IMAGE_OWNED|IMAGE_SHMI|IMAGE_SHMP, ww, hh);
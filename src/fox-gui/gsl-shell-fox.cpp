@@ -13,7 +13,7 @@ struct window_hooks app_window_hooks[1] = {{
         fox_window_slot_update, fox_window_slot_refresh,
         fox_window_close, fox_window_close,
         fox_window_save_slot_image, fox_window_restore_slot_image,
-        fox_window_register,
+        fox_window_stats, fox_window_register,
     }
 };
 
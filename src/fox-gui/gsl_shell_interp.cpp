@@ -16,6 +16,7 @@ extern "C" {
 #include "lua-filesystem.h"
 #include "lua-graph.h"
 #include "lua-gsl.h"
+#include "lua-parallel.h"
 #include "platform.h"
 
 static void stderr_message(const char *pname, const char *msg)
@@ -86,6 +87,7 @@ static int pinit(lua_State *L)
     luaopen_gsl (L);
     register_graph (L);
     luaopen_filesystem (L);
+    luaopen_parallel (L);
     lua_gc(L, LUA_GCRESTART, -1);
     run_start_script(L);
     return 0;
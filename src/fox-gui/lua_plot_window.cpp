@@ -285,6 +285,31 @@ fox_window_restore_slot_image (lua_State *L)
     return nret;
 }
 
+static int
+fox_window_stats_try(lua_State *L)
+{
+    window_mutex wm(L, 1);
+
+    if (!wm.is_defined()) return type_error_return(L, 1, "window");
+
+    bool reset = lua_toboolean(L, 2);
+    window_surface& surface = wm.window()->surface();
+    render_stats stats = surface.stats();
+    if (reset)
+        surface.stats().clear();
+
+    render_stats_push(L, stats);
+    return 1;
+}
+
+int
+fox_window_stats(lua_State *L)
+{
+    int nret = fox_window_stats_try(L);
+    if (nret < 0) lua_error(L);
+    return nret;
+}
+
 static int
 fox_window_export_svg_try(lua_State *L)
 {
@@ -292,6 +317,7 @@ fox_window_export_svg_try(lua_State *L)
     const char *filename = lua_tostring(L, 2);
     const double w = luaL_optnumber(L, 3, 600.0);
     const double h = luaL_optnumber(L, 4, 600.0);
+    const double tolerance = luaL_optnumber(L, 5, 0.0);
 
     if (!wm.is_defined()) return type_error_return(L, 1, "window");
 
@@ -317,7 +343,7 @@ fox_window_export_svg_try(lua_State *L)
     fx_plot_window* win = wm.window();
     window_surface& surface = win->surface();
 
-    canvas_svg canvas(f, h);
+    canvas_svg canvas(f, h, tolerance);
     canvas.write_header(w, h);
 
     unsigned n = surface.plot_number();
@@ -330,7 +356,7 @@ fox_window_export_svg_try(lua_State *L)
             agg::rect_i area = surface.get_plot_area(k, int(w), int(h));
             sprintf(plot_name, "plot%u", k + 1);
             canvas.write_group_header(plot_name);
-            p->draw(canvas, area, NULL);
+            p->draw(canvas, area, NULL, true);
             canvas.write_group_end(plot_name);
         }
     }
@@ -16,6 +16,7 @@ extern int fox_window_slot_refresh        (lua_State *L);
 extern int fox_window_slot_update         (lua_State *L);
 extern int fox_window_save_slot_image     (lua_State *L);
 extern int fox_window_restore_slot_image  (lua_State *L);
+extern int fox_window_stats               (lua_State *L);
 extern int fox_window_show                (lua_State* L);
 
 __END_DECLS
@@ -48,8 +48,23 @@ bool window_surface::resize(unsigned ww, unsigned hh)
     return false;
 }
 
+// Start a frame of the stats of the window and of the plots, only the
+// plot "index" if it is not negative.
+void window_surface::frame_begin(int index)
+{
+    m_stats.frame_begin();
+    graph_lock();
+    for (unsigned k = 0; k < plot_number(); k++)
+    {
+        if (m_plots[k].plot && (index < 0 || unsigned(index) == k))
+            m_plots[k].plot->stats().frame_begin();
+    }
+    graph_mutex::unlock();
+}
+
 void window_surface::draw_image_buffer()
 {
+    frame_begin();
     for (unsigned k = 0; k < plot_number(); k++)
         render(k);
 }
@@ -59,8 +74,13 @@ void window_surface::render(plot_ref& ref, const agg::rect_i& r)
     m_canvas->clear_box(r);
     if (ref.plot)
     {
-        graph_mutex::lock();
-        ref.plot->draw(*m_canvas, r, &ref.inf);
+        graph_lock();
+        const render_stats::counters counts = ref.plot->stats().frame();
+        {
+            render_timer timer(&m_stats, render_stats::render);
+            ref.plot->draw(*m_canvas, r, &ref.inf);
+        }
+        m_stats.add_counts(ref.plot->stats().frame(), counts);
         graph_mutex::unlock();
     }
 }
@@ -79,8 +99,13 @@ window_surface::render_drawing_queue(plot_ref& ref, const agg::rect_i& box)
     const agg::trans_affine m = affine_matrix(box);
     opt_rect<double> r;
 
-    graph_mutex::lock();
-    ref.plot->draw_queue(*m_canvas, m, ref.inf, r);
+    graph_lock();
+    const render_stats::counters counts = ref.plot->stats().frame();
+    {
+        render_timer timer(&m_stats, render_stats::render);
+        ref.plot->draw_queue(*m_canvas, m, ref.inf, r);
+    }
+    m_stats.add_counts(ref.plot->stats().frame(), counts);
     graph_mutex::unlock();
 
     opt_rect<int> ri;
@@ -147,9 +172,20 @@ agg::rect_i window_surface::get_plot_area(unsigned index, int width, int height)
     return m_part.rect(index, width, height);
 }
 
+void window_surface::graph_lock()
+{
+    render_timer timer(&m_stats, render_stats::lock_wait);
+    graph_mutex::lock();
+}
+
 void window_surface::slot_refresh(unsigned index)
 {
+    m_stats.frame_begin();
+    graph_lock();
+    plot(index)->stats().frame_begin();
+    plot(index)->update_incremental_limits();
     bool redraw = plot(index)->need_redraw();
+    graph_mutex::unlock();
     if (redraw)
     {
         render(index);
@@ -177,6 +213,7 @@ void window_surface::slot_refresh(unsigned index)
 void
 window_surface::slot_update(unsigned index)
 {
+    frame_begin(index);
     render(index);
     render_drawing_queue(index);
     agg::rect_i area = get_plot_area(index);
@@ -186,6 +223,7 @@ window_surface::slot_update(unsigned index)
 void
 window_surface::draw_all()
 {
+    frame_begin();
     for (unsigned k = 0; k < m_plots.size(); k++)
         render(k);
     const agg::rect_i r(0, 0, get_width(), get_height());
@@ -13,6 +13,7 @@
 #include "sg_object.h"
 #include "lua-plot-cpp.h"
 #include "canvas.h"
+#include "render_stats.h"
 #include "rect.h"
 
 struct display_window {
@@ -81,8 +82,15 @@ public:
     void save_slot_image(unsigned index);
     void restore_slot_image(unsigned index);
 
+    // Each call to slot_refresh, slot_update, draw_all or
+    // draw_image_buffer is a frame of the stats, of the window and of the
+    // plots drawn.
+    render_stats& stats() { return m_stats; }
+
 private:
     void clear_plots_list();
+    void graph_lock();
+    void frame_begin(int index = -1);
 
     void render(plot_ref& ref, const agg::rect_i& r);
 
@@ -99,6 +107,7 @@ private:
     agg::pod_bvector<plot_ref> m_plots;
     display_window* m_window;
     canvas* m_canvas;
+    render_stats m_stats;
 };
 
 #endif
@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "gdt_sampling.h"
+
+/* Piecewise linear simplification of the curves y_q(x) where y_q are
+   the "ny" columns of "y", each one of "n" values. Each segment goes
+   from a selected point "a" to the farthest point "b" such that, for
+   each curve, all the points in between are within the tolerance of
+   the straight line from a to b. The tolerance is eps_rels[q] times
+   the range of the values of y_q.
+
+   For each curve the slopes of the lines from "a" that pass within the
+   tolerance of all the points seen so far form an interval, the
+   feasible slope cone. The line to b is acceptable iff its slope falls
+   in the cone of the points before b so each point is checked in
+   constant time. The scan stops when the cone becomes empty because no
+   line from a can then be acceptable.
+
+   The indexes of the selected points, always including the first and
+   the last one, are stored in "index" and their number is returned or
+   -1 if the memory cannot be allocated. */
+int
+gdt_sampling_optimize(const double *x, const double *y, int ny, int n, const double *eps_rels, int *index)
+{
+    if (n <= 0) return 0;
+
+    double *tol = malloc(3 * ny * sizeof(double));
+    if (unlikely(tol == NULL)) return (-1);
+    double *lo = tol + ny, *hi = tol + 2 * ny;
+
+    for (int q = 0; q < ny; q++) {
+        const double *yq = y + (size_t) q * n;
+        double y_min = yq[0], y_max = yq[0];
+        for (int i = 1; i < n; i++) {
+            if (yq[i] < y_min) y_min = yq[i];
+            if (yq[i] > y_max) y_max = yq[i];
+        }
+        tol[q] = eps_rels[q] * (y_max > y_min ? y_max - y_min : 1);
+    }
+
+    int count = 0;
+    int a = 0;
+    index[count++] = 0;
+    while (a < n - 1) {
+        int b_select = a + 1;
+        for (int q = 0; q < ny; q++) {
+            lo[q] = -HUGE_VAL;
+            hi[q] = HUGE_VAL;
+        }
+        for (int b = a + 1; b < n; b++) {
+            const double dx = x[b] - x[a];
+            int acceptable = 1, feasible = 1;
+            for (int q = 0; q < ny; q++) {
+                const double *yq = y + (size_t) q * n;
+                const double dy = yq[b] - yq[a];
+                if (dx != 0) {
+                    const double s = dy / dx;
+                    if (!(s >= lo[q] && s <= hi[q])) {
+                        acceptable = 0;
+                    }
+                    double s1 = (dy - tol[q]) / dx, s2 = (dy + tol[q]) / dx;
+                    if (dx < 0) {
+                        double tmp = s1;
+                        s1 = s2;
+                        s2 = tmp;
+                    }
+                    if (s1 > lo[q]) lo[q] = s1;
+                    if (s2 < hi[q]) hi[q] = s2;
+                    if (lo[q] > hi[q]) feasible = 0;
+                } else {
+                    acceptable = 0;
+                    if (fabs(dy) > tol[q]) feasible = 0;
+                }
+            }
+            if (acceptable || b == a + 1) {
+                b_select = b;
+            }
+            if (!feasible) break;
+        }
+        index[count++] = b_select;
+        a = b_select;
+    }
+
+    free(tol);
+    return count;
+}
@@ -0,0 +1,8 @@
+#ifndef GDT_SAMPLING_H
+#define GDT_SAMPLING_H
+
+#include "defs.h"
+
+extern int gdt_sampling_optimize(const double *x, const double *y, int ny, int n, const double *eps_rels, int *index);
+
+#endif
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
 
 #include "gdt_table.h"
 #include "gdt_table_priv.h"
@@ -404,6 +405,55 @@ gdt_table_insert_rows(gdt_table *t, int i_in, int n)
     return 0;
 }
 
+/* Store in "out" the values of the column j. The elements that are not
+   numbers are set to NaN and their number is returned. */
+int
+gdt_table_get_column(const gdt_table *t, int j, double *out)
+{
+    int nan_count = 0;
+    for (int i = 0; i < t->size1; i++) {
+        const gdt_element *e = &t->data[i * t->tda + j];
+        if (e->word.hi <= TAG_NUMBER) {
+            out[i] = e->number;
+        } else {
+            out[i] = NAN;
+            nan_count ++;
+        }
+    }
+    return nan_count;
+}
+
+/* Return a new table with the same columns of "t" and the n rows whose
+   indexes are given in "rows". */
+gdt_table *
+gdt_table_select_rows(const gdt_table *t, const int *rows, int n)
+{
+    const int n2 = t->size2;
+    gdt_table *r = gdt_table_new(n, n2, n);
+    if (unlikely(r == NULL)) return NULL;
+
+    for (int j = 0; j < n2; j++) {
+        const char *name = string_array_get(t->headers, j);
+        if (name) {
+            string_array_set(r->headers, j, name);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        const gdt_element *src = &t->data[rows[i] * t->tda];
+        gdt_element *dst = &r->data[i * r->tda];
+        for (int j = 0; j < n2; j++) {
+            if (elem_is_string(&src[j])) {
+                gdt_table_set_string(r, i, j, gdt_index_get(t->strings, src[j].word.lo));
+            } else {
+                dst[j] = src[j];
+            }
+        }
+    }
+
+    return r;
+}
+
 gdt_table_cursor *
 gdt_table_get_cursor(gdt_table *t)
 {
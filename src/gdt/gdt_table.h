@@ -35,6 +35,8 @@ extern void                gdt_table_set_header         (gdt_table *t, int j, co
 extern int                 gdt_table_header_index       (const gdt_table *t, const char* col_name);
 extern int                 gdt_table_insert_columns     (gdt_table *t, int j_in, int n);
 extern int                 gdt_table_insert_rows        (gdt_table *t, int i_in, int n);
+extern int                 gdt_table_get_column         (const gdt_table *t, int j, double *out);
+extern gdt_table *         gdt_table_select_rows        (const gdt_table *t, const int *rows, int n);
 extern gdt_value_enum      gdt_table_cursor_get         (const gdt_table_cursor *c, const char *key, gdt_value *value);
 extern gdt_table_cursor *  gdt_table_get_cursor         (gdt_table *t);
 extern int                 gdt_table_cursor_set_number  (gdt_table_cursor *c, const char *key, double x);
@@ -0,0 +1,194 @@
+
+/* array-eval.c
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Evaluation of a GSL function over all the elements of a matrix. The
+   function is called from Lua using the FFI with the pointer of the GSL
+   function and its kind to avoid the cost of a call from Lua for each
+   element. Large matrices are split between several threads. */
+
+#include <math.h>
+#include <pthread.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_mode.h>
+#include <gsl/gsl_sf_result.h>
+
+#include "array-eval.h"
+
+#define ARRAY_EVAL_MAX_THREADS 64
+/* minimum number of elements given to each thread */
+#define ARRAY_EVAL_MIN_CHUNK 4096
+
+typedef int (*sf_x_fn) (double, gsl_sf_result *);
+typedef int (*sf_xm_fn) (double, gsl_mode_t, gsl_sf_result *);
+typedef int (*sf_ix_fn) (int, double, gsl_sf_result *);
+typedef int (*sf_px_fn) (double, double, gsl_sf_result *);
+typedef double (*x_fn) (double);
+typedef double (*xp_fn) (double, double);
+typedef double (*xpp_fn) (double, double, double);
+typedef double (*kp_fn) (unsigned int, double);
+typedef double (*kpu_fn) (unsigned int, double, unsigned int);
+typedef double (*kpp_fn) (unsigned int, double, double);
+
+struct array_eval_job {
+  int kind;
+  void *fn;
+  double p[ARRAY_EVAL_MAX_PARAMS];
+  const double *x;
+  size_t xtda;
+  double *y;
+  size_t ytda;
+  size_t n2;
+  /* range of the elements in row-major order */
+  size_t start, end;
+  int nerrors;
+};
+
+/* Return the value of the function for x or NaN, and increment
+   "nerrors", if the function fails. Underflows are not errors and give
+   the value computed by GSL. */
+static double
+eval_element (const struct array_eval_job *job, double x, int *nerrors)
+{
+  gsl_sf_result r;
+  int status;
+
+  switch (job->kind)
+    {
+    case ARRAY_EVAL_SF_X:
+      status = ((sf_x_fn) job->fn) (x, &r);
+      break;
+    case ARRAY_EVAL_SF_XM:
+      status = ((sf_xm_fn) job->fn) (x, GSL_PREC_DOUBLE, &r);
+      break;
+    case ARRAY_EVAL_SF_IX:
+      status = ((sf_ix_fn) job->fn) ((int) job->p[0], x, &r);
+      break;
+    case ARRAY_EVAL_SF_PX:
+      status = ((sf_px_fn) job->fn) (job->p[0], x, &r);
+      break;
+    case ARRAY_EVAL_X:
+      return ((x_fn) job->fn) (x);
+    case ARRAY_EVAL_XP:
+      return ((xp_fn) job->fn) (x, job->p[0]);
+    case ARRAY_EVAL_XPP:
+      return ((xpp_fn) job->fn) (x, job->p[0], job->p[1]);
+    default:
+      if (!(x >= 0))
+        {
+          (*nerrors)++;
+          return NAN;
+        }
+      if (job->kind == ARRAY_EVAL_KP)
+        return ((kp_fn) job->fn) ((unsigned int) x, job->p[0]);
+      if (job->kind == ARRAY_EVAL_KPU)
+        return ((kpu_fn) job->fn) ((unsigned int) x, job->p[0], (unsigned int) job->p[1]);
+      return ((kpp_fn) job->fn) ((unsigned int) x, job->p[0], job->p[1]);
+    }
+
+  if (status != GSL_SUCCESS && status != GSL_EUNDRFLW)
+    {
+      (*nerrors)++;
+      return NAN;
+    }
+  return r.val;
+}
+
+static void *
+array_eval_run (void *data)
+{
+  struct array_eval_job *job = (struct array_eval_job *) data;
+  size_t i = job->start / job->n2, j = job->start % job->n2, e;
+  int nerrors = 0;
+
+  for (e = job->start; e < job->end; e++)
+    {
+      job->y[i * job->ytda + j] = eval_element (job, job->x[i * job->xtda + j], &nerrors);
+      if (++j == job->n2)
+        {
+          j = 0;
+          i++;
+        }
+    }
+
+  job->nerrors = nerrors;
+  return NULL;
+}
+
+/* Store in y the value of the function "fn" for each element of the
+   n1 x n2 matrix x. Return the number of elements where the function
+   failed, their value is set to NaN. */
+int
+gsl_shell_array_eval (int kind, void *fn, const double *params, int nparams,
+                      const double *x, size_t n1, size_t n2, size_t xtda,
+                      double *y, size_t ytda, int nthreads)
+{
+  struct array_eval_job jobs[ARRAY_EVAL_MAX_THREADS];
+  pthread_t threads[ARRAY_EVAL_MAX_THREADS];
+  size_t n = n1 * n2;
+  int k, nstarted, nerrors = 0;
+
+  if (n == 0)
+    return 0;
+
+  if (nthreads > ARRAY_EVAL_MAX_THREADS)
+    nthreads = ARRAY_EVAL_MAX_THREADS;
+  if ((size_t) nthreads > n / ARRAY_EVAL_MIN_CHUNK)
+    nthreads = n / ARRAY_EVAL_MIN_CHUNK;
+  if (nthreads < 1)
+    nthreads = 1;
+
+  for (k = 0; k < nthreads; k++)
+    {
+      struct array_eval_job *job = &jobs[k];
+      int i;
+      job->kind = kind;
+      job->fn = fn;
+      for (i = 0; i < ARRAY_EVAL_MAX_PARAMS; i++)
+        job->p[i] = (i < nparams ? params[i] : 0.0);
+      job->x = x;
+      job->xtda = xtda;
+      job->y = y;
+      job->ytda = ytda;
+      job->n2 = n2;
+      job->start = (n * k) / nthreads;
+      job->end = (n * (k + 1)) / nthreads;
+    }
+
+  /* the first job is run in the current thread, like the jobs of the
+     threads that cannot be created */
+  for (nstarted = 1; nstarted < nthreads; nstarted++)
+    {
+      if (pthread_create (&threads[nstarted], NULL, array_eval_run, &jobs[nstarted]) != 0)
+        break;
+    }
+
+  array_eval_run (&jobs[0]);
+  for (k = nstarted; k < nthreads; k++)
+    array_eval_run (&jobs[k]);
+
+  for (k = 1; k < nstarted; k++)
+    pthread_join (threads[k], NULL);
+
+  for (k = 0; k < nthreads; k++)
+    nerrors += jobs[k].nerrors;
+
+  return nerrors;
+}
@@ -0,0 +1,36 @@
+#ifndef ARRAY_EVAL_H
+#define ARRAY_EVAL_H
+
+#include <stddef.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Signature of the functions evaluated over the arrays. The "sf" kinds
+   are special functions returning a status and a gsl_sf_result, the
+   other ones return directly the value, like the probability densities
+   and the cumulative distributions. x is the array's element, p a real
+   parameter, i an integer parameter, k and u unsigned values. */
+enum array_eval_kind {
+  ARRAY_EVAL_SF_X = 0,  /* int f(double x, gsl_sf_result *r) */
+  ARRAY_EVAL_SF_XM,     /* int f(double x, gsl_mode_t mode, gsl_sf_result *r) */
+  ARRAY_EVAL_SF_IX,     /* int f(int i, double x, gsl_sf_result *r) */
+  ARRAY_EVAL_SF_PX,     /* int f(double p, double x, gsl_sf_result *r) */
+  ARRAY_EVAL_X,         /* double f(double x) */
+  ARRAY_EVAL_XP,        /* double f(double x, double p1) */
+  ARRAY_EVAL_XPP,       /* double f(double x, double p1, double p2) */
+  ARRAY_EVAL_KP,        /* double f(unsigned k, double p1) */
+  ARRAY_EVAL_KPU,       /* double f(unsigned k, double p1, unsigned u) */
+  ARRAY_EVAL_KPP,       /* double f(unsigned k, double p1, double p2) */
+};
+
+#define ARRAY_EVAL_MAX_PARAMS 2
+
+extern int gsl_shell_array_eval (int kind, void *fn, const double *params, int nparams,
+                                 const double *x, size_t n1, size_t n2, size_t xtda,
+                                 double *y, size_t ytda, int nthreads);
+
+__END_DECLS
+
+#endif
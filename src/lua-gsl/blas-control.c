@@ -0,0 +1,74 @@
+
+/* blas-control.c
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Report and control the CBLAS library used by GSL. The functions are
+   called from Lua using the FFI. The define GSL_SHELL_OPENBLAS is set by
+   the build when GSL is linked with OpenBLAS. */
+
+#include "blas-control.h"
+
+#ifdef GSL_SHELL_OPENBLAS
+extern void   openblas_set_num_threads (int num_threads);
+extern int    openblas_get_num_threads (void);
+extern char * openblas_get_config (void);
+#endif
+
+const char *
+gsl_shell_blas_name (void)
+{
+#ifdef GSL_SHELL_OPENBLAS
+  return "openblas";
+#else
+  return "gslcblas";
+#endif
+}
+
+const char *
+gsl_shell_blas_config (void)
+{
+#ifdef GSL_SHELL_OPENBLAS
+  return openblas_get_config ();
+#else
+  return "GSL reference CBLAS";
+#endif
+}
+
+int
+gsl_shell_blas_threads (void)
+{
+#ifdef GSL_SHELL_OPENBLAS
+  return openblas_get_num_threads ();
+#else
+  return 1;
+#endif
+}
+
+/* Set the number of threads used by the BLAS routines and return the
+   number of threads actually used. */
+int
+gsl_shell_blas_set_threads (int n)
+{
+#ifdef GSL_SHELL_OPENBLAS
+  openblas_set_num_threads (n);
+  return openblas_get_num_threads ();
+#else
+  return 1;
+#endif
+}
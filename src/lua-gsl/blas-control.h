@@ -0,0 +1,15 @@
+#ifndef BLAS_CONTROL_H
+#define BLAS_CONTROL_H
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+extern const char * gsl_shell_blas_name      (void);
+extern const char * gsl_shell_blas_config    (void);
+extern int          gsl_shell_blas_threads   (void);
+extern int          gsl_shell_blas_set_threads (int n);
+
+__END_DECLS
+
+#endif
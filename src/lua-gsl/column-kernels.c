@@ -0,0 +1,369 @@
+
+/* column-kernels.c
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Numeric kernels working on the columns of the data tables copied in
+   contiguous buffers. They are used by gdt.integrate and gdt.interp.
+   The missing values are stored as NaN. */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "column-kernels.h"
+
+/* Check that the values of x are strictly increasing. If not, return
+   the kind of error and store in "index" the position of the value
+   found missing or of the first value of the pair not increasing. */
+int
+gsl_shell_column_check_increasing (const double *x, size_t n, size_t *index)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (isnan (x[i]))
+        {
+          *index = i;
+          return COLUMN_MISSING;
+        }
+      if (i > 0 && x[i] <= x[i-1])
+        {
+          *index = i - 1;
+          return (x[i] == x[i-1] ? COLUMN_REPEATED : COLUMN_DECREASING);
+        }
+    }
+
+  return COLUMN_OK;
+}
+
+/* Remove the pairs (x, y) where one of the values is missing and
+   return the number of pairs kept. */
+size_t
+gsl_shell_column_drop_missing (double *x, double *y, size_t n)
+{
+  size_t i, k = 0;
+
+  for (i = 0; i < n; i++)
+    {
+      if (!isnan (x[i]) && !isnan (y[i]))
+        {
+          x[k] = x[i];
+          y[k] = y[i];
+          k++;
+        }
+    }
+
+  return k;
+}
+
+/* Integral of y(x) over [x1, x2] using the trapezoid rule. The
+   intervals partially inside [x1, x2] are clipped using the linear
+   interpolation of y and the intervals with a missing value of y are
+   skipped. */
+double
+gsl_shell_column_trapezoid (const double *x, const double *y, size_t n, double x1, double x2)
+{
+  double sum = 0;
+  size_t i;
+
+  for (i = 0; i + 1 < n; i++)
+    {
+      double xi = x[i], xip = x[i+1], yi = y[i], yip = y[i+1];
+
+      if (isnan (yi) || isnan (yip))
+        continue;
+
+      if (xi >= x1 && xip <= x2)
+        {
+          sum += (xip - xi) * (yi + yip) / 2;
+        }
+      else if (xi <= x2 && xip >= x1)
+        {
+          const double dydx = (yip - yi) / (xip - xi);
+          if (xi < x1)
+            {
+              yi = yi + (x1 - xi) * dydx;
+              xi = x1;
+            }
+          if (xip > x2)
+            {
+              yip = yi + (x2 - xi) * dydx;
+              xip = x2;
+            }
+          sum += (xip - xi) * (yi + yip) / 2;
+        }
+    }
+
+  return sum;
+}
+
+/* Integral over [u, v] of the parabola passing by the three points
+   (x[k], y[k]). */
+static double
+parabola_integral (const double *x, const double *y, double u, double v)
+{
+  const double h0 = x[1] - x[0], h1 = x[2] - x[1];
+  const double d1 = (y[1] - y[0]) / h0;
+  const double d2 = ((y[2] - y[1]) / h1 - d1) / (h0 + h1);
+  const double a = u - x[0], b = v - x[0];
+  const double a2 = a * a, b2 = b * b;
+  return y[0] * (b - a) + d1 * (b2 - a2) / 2 + d2 * ((b2 * b - a2 * a) / 3 - h0 * (b2 - a2) / 2);
+}
+
+static int
+has_missing (const double *y, int n)
+{
+  int k;
+  for (k = 0; k < n; k++)
+    {
+      if (isnan (y[k]))
+        return 1;
+    }
+  return 0;
+}
+
+/* Integral of y(x) over [x1, x2] using the Simpson rule for non
+   uniformly spaced points. The integral of the parabola through the
+   points 2k, 2k+1 and 2k+2 is taken on the part of [x_2k, x_2k+2]
+   inside [x1, x2]. If the number of intervals is odd the last one uses
+   the parabola through the last three points. The panels with a
+   missing value of y are skipped. */
+double
+gsl_shell_column_simpson (const double *x, const double *y, size_t n, double x1, double x2)
+{
+  double sum = 0;
+  size_t i;
+
+  if (n < 3)
+    return gsl_shell_column_trapezoid (x, y, n, x1, x2);
+
+  for (i = 0; i + 2 < n; i += 2)
+    {
+      const double u = (x[i] > x1 ? x[i] : x1), v = (x[i+2] < x2 ? x[i+2] : x2);
+      if (u < v && !has_missing (y + i, 3))
+        sum += parabola_integral (x + i, y + i, u, v);
+    }
+
+  if (n % 2 == 0)
+    {
+      const double u = (x[n-2] > x1 ? x[n-2] : x1), v = (x[n-1] < x2 ? x[n-1] : x2);
+      if (u < v && !has_missing (y + n - 3, 3))
+        sum += parabola_integral (x + n - 3, y + n - 3, u, v);
+    }
+
+  return sum;
+}
+
+/* Return the k-th smallest element of the n values of "a" reordering
+   them. */
+static double
+select_kth (double *a, size_t n, size_t k)
+{
+  long lo = 0, hi = (long) n - 1, kk = (long) k;
+
+  while (lo < hi)
+    {
+      const double pivot = a[lo + (hi - lo) / 2];
+      long i = lo, j = hi;
+      while (i <= j)
+        {
+          while (a[i] < pivot) i++;
+          while (a[j] > pivot) j--;
+          if (i <= j)
+            {
+              const double tmp = a[i];
+              a[i] = a[j];
+              a[j] = tmp;
+              i++;
+              j--;
+            }
+        }
+      if (kk <= j)
+        hi = j;
+      else if (kk >= i)
+        lo = i;
+      else
+        break;
+    }
+
+  return a[k];
+}
+
+/* Prepare the data for the GSL interpolators. The values of x should be
+   monotonic but the values closer than a small fraction of the median
+   step are considered equal and the points are fused by averaging
+   them. The points are reordered if x is decreasing. The number of
+   points left is stored in "n_out".
+
+   In case of error the index of the value and, for non monotonic data,
+   the previous value are stored in "index" and "x_prev". */
+int
+gsl_shell_column_interp_prepare (double *x, double *y, size_t n, size_t *n_out,
+                                 size_t *index, double *x_prev)
+{
+  /* regulate the threshold when closely spaced x values are considered
+     almost equal and fused into a single point. */
+  const double x_del_fraction = 1e-3;
+  /* value close to the smallest positive normalized double to detect
+     when the values are not really changing except for rounding. */
+  const double x_del_abs_min = 1.0e-250;
+  double del_min, del_max, del_median, del_eps, xp;
+  double *del;
+  size_t i, k, m;
+  int dir = 0, ndup = 0;
+
+  *n_out = n;
+  if (n < 2)
+    return COLUMN_OK;
+
+  for (i = 0; i < n; i++)
+    {
+      if (isnan (x[i]) || isinf (x[i]))
+        {
+          *index = i;
+          return (isnan (x[i]) ? COLUMN_MISSING : COLUMN_INFINITE);
+        }
+    }
+
+  del = malloc ((n - 1) * sizeof (double));
+  if (del == NULL)
+    return COLUMN_NOMEM;
+
+  del_min = del_max = x[1] - x[0];
+  for (i = 0; i < n - 1; i++)
+    {
+      del[i] = x[i+1] - x[i];
+      if (del[i] < del_min) del_min = del[i];
+      if (del[i] > del_max) del_max = del[i];
+    }
+  del_median = select_kth (del, n - 1, (n - 1) % 2 == 0 ? (n - 1) / 2 - 1 : n / 2 - 1);
+  free (del);
+
+  if (!((del_max < 0 || del_max > x_del_abs_min) && (del_min > 0 || del_min < -x_del_abs_min)))
+    return COLUMN_SMALL_STEPS;
+
+  {
+    const double del_abs_max = fmax (fabs (del_min), fabs (del_max));
+    del_eps = fmax (fabs (del_median), del_abs_max * 1e-2) * x_del_fraction;
+  }
+
+  xp = x[0];
+  for (i = 1; i < n; i++)
+    {
+      const double del_i = x[i] - xp;
+      const int dir_i = (fabs (del_i) < del_eps ? 0 : (del_i > 0 ? 1 : -1));
+      if (dir_i == 0)
+        {
+          ndup++;
+        }
+      else
+        {
+          if (dir == 0)
+            {
+              dir = dir_i;
+            }
+          else if (dir != dir_i)
+            {
+              *index = i;
+              *x_prev = xp;
+              return COLUMN_DECREASING;
+            }
+          xp = x[i];
+        }
+    }
+
+  if (ndup > 0)
+    {
+      double x_sum = 0, y_sum = 0;
+      int count = 0;
+      xp = x[0];
+      for (i = 0, k = 0; i < n; i++)
+        {
+          /* the fused group ends if the next value is not close to the
+             first value of the group. */
+          const double x_first = xp;
+          count++;
+          x_sum += x[i];
+          y_sum += y[i];
+          if (i + 1 == n || fabs (x[i+1] - x_first) >= del_eps)
+            {
+              x[k] = x_sum / count;
+              y[k] = y_sum / count;
+              k++;
+              count = 0;
+              x_sum = y_sum = 0;
+              if (i + 1 < n)
+                xp = x[i+1];
+            }
+        }
+      n = k;
+    }
+
+  if (dir < 0)
+    {
+      for (i = 0, m = n - 1; i < m; i++, m--)
+        {
+          double tx = x[i], ty = y[i];
+          x[i] = x[m];
+          y[i] = y[m];
+          x[m] = tx;
+          y[m] = ty;
+        }
+    }
+
+  *n_out = n;
+  return COLUMN_OK;
+}
+
+/* Evaluate the interpolator for each element of the n1 x n2 matrix x
+   and store the values in y. Outside of the data range the function is
+   extended linearly using the derivative at the end points. */
+void
+gsl_shell_column_interp_eval (const gsl_interp *interp, const double *xa,
+                              const double *ya, size_t n, const double *x,
+                              size_t n1, size_t n2, size_t xtda,
+                              double *y, size_t ytda)
+{
+  gsl_interp_accel *acc = gsl_interp_accel_alloc ();
+  const double x_a = xa[0], x_b = xa[n-1];
+  const double y_a = ya[0], y_b = ya[n-1];
+  const double der_a = gsl_interp_eval_deriv (interp, xa, ya, x_a, acc);
+  const double der_b = gsl_interp_eval_deriv (interp, xa, ya, x_b, acc);
+  size_t i, j;
+
+  for (i = 0; i < n1; i++)
+    {
+      for (j = 0; j < n2; j++)
+        {
+          const double v = x[i * xtda + j];
+          double r;
+          if (isnan (v))
+            r = v;
+          else if (v <= x_a)
+            r = (v - x_a) * der_a + y_a;
+          else if (v >= x_b)
+            r = (v - x_b) * der_b + y_b;
+          else
+            r = gsl_interp_eval (interp, xa, ya, v, acc);
+          y[i * ytda + j] = r;
+        }
+    }
+
+  gsl_interp_accel_free (acc);
+}
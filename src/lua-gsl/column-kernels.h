@@ -0,0 +1,39 @@
+#ifndef COLUMN_KERNELS_H
+#define COLUMN_KERNELS_H
+
+#include <stddef.h>
+
+#include <gsl/gsl_interp.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Status codes returned by the checks of the columns. The index and
+   the values where the check failed are returned by the function. */
+enum column_status {
+  COLUMN_OK = 0,
+  COLUMN_MISSING,      /* NaN value, used for the missing values */
+  COLUMN_INFINITE,
+  COLUMN_REPEATED,
+  COLUMN_DECREASING,
+  COLUMN_SMALL_STEPS,  /* variations of x too small */
+  COLUMN_NOMEM,
+};
+
+extern int    gsl_shell_column_check_increasing (const double *x, size_t n, size_t *index);
+extern size_t gsl_shell_column_drop_missing     (double *x, double *y, size_t n);
+extern double gsl_shell_column_trapezoid        (const double *x, const double *y, size_t n,
+                                                 double x1, double x2);
+extern double gsl_shell_column_simpson          (const double *x, const double *y, size_t n,
+                                                 double x1, double x2);
+extern int    gsl_shell_column_interp_prepare   (double *x, double *y, size_t n, size_t *n_out,
+                                                 size_t *index, double *x_prev);
+extern void   gsl_shell_column_interp_eval      (const gsl_interp *interp, const double *xa,
+                                                 const double *ya, size_t n, const double *x,
+                                                 size_t n1, size_t n2, size_t xtda,
+                                                 double *y, size_t ytda);
+
+__END_DECLS
+
+#endif
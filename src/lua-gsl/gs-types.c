@@ -12,10 +12,13 @@
 #define GS_DRAW_SCALABLE_NAME_DEF NULL
 #define GS_DRAW_PATH_NAME_DEF   "GSL.path"
 #define GS_DRAW_ELLIPSE_NAME_DEF   "GSL.ellipse"
+#define GS_DRAW_STREAM_NAME_DEF   "GSL.stream"
 #define GS_DRAW_DRAWABLE_NAME_DEF NULL
 #define GS_DRAW_TEXT_NAME_DEF   "GSL.text"
 #define GS_DRAW_TEXTSHAPE_NAME_DEF "GSL.textshape"
 #define GS_DRAW_MARKER_NAME_DEF "GSL.marker"
+#define GS_DRAW_MESH_NAME_DEF   "GSL.mesh"
+#define GS_CONTOUR_GRID_NAME_DEF "GSL.contour"
 #define GS_PLOT_NAME_DEF  "GSL.plot"
 
 #define MYCAT2x(a,b) a ## _ ## b
@@ -31,10 +34,13 @@ const struct gs_type gs_type_table[] = {
   MY_EXPAND(DRAW_SCALABLE, "graphical object"),
   MY_EXPAND_DER(DRAW_PATH, "geometric line", DRAW_SCALABLE),
   MY_EXPAND_DER(DRAW_ELLIPSE, "geometric ellipse", DRAW_SCALABLE),
+  MY_EXPAND_DER(DRAW_STREAM, "data stream", DRAW_SCALABLE),
   MY_EXPAND(DRAW_DRAWABLE, "window graphical object"),
   MY_EXPAND_DER(DRAW_TEXT, "graphical text", DRAW_DRAWABLE),
   MY_EXPAND_DER(DRAW_TEXTSHAPE, "geometric text shape", DRAW_DRAWABLE),
   MY_EXPAND_DER(DRAW_MARKER, "marker point", DRAW_DRAWABLE),
+  MY_EXPAND_DER(DRAW_MESH, "3D mesh", DRAW_DRAWABLE),
+  MY_EXPAND(CONTOUR_GRID, "contour grid"),
   MY_EXPAND(PLOT, "plot"),
   {GS_INVALID_TYPE, NULL, NULL, GS_NO_TYPE}
 };
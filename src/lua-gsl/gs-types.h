@@ -14,10 +14,13 @@ enum gs_type_e {
   GS_DRAW_SCALABLE, /* derived types are declared only after their base class */
   GS_DRAW_PATH,
   GS_DRAW_ELLIPSE,
+  GS_DRAW_STREAM,
   GS_DRAW_DRAWABLE,
   GS_DRAW_TEXT,
   GS_DRAW_TEXTSHAPE,
   GS_DRAW_MARKER,
+  GS_DRAW_MESH,
+  GS_CONTOUR_GRID,
   GS_PLOT,
   GS_INVALID_TYPE,
 };
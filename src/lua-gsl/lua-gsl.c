@@ -32,12 +32,35 @@
 #include "fatal.h"
 
 #include "gdt_table.h"
+#include "gdt_sampling.h"
+#include "blas-control.h"
+#include "array-eval.h"
+#include "rnd-fill.h"
+#include "column-kernels.h"
 
 /* used to force the linker to link the gdt library. Otherwise it
  * would be discarded as there are no other references to its functions. */
 extern gdt_table *(*_gdt_ref)(int nb_rows, int nb_columns, int nb_rows_alloc);
 gdt_table *(*_gdt_ref)(int nb_rows, int nb_columns, int nb_rows_alloc) = gdt_table_new;
 
+extern int (*_gdt_sampling_ref)(const double *, const double *, int, int, const double *, int *);
+int (*_gdt_sampling_ref)(const double *, const double *, int, int, const double *, int *) = gdt_sampling_optimize;
+
+/* same as above for the BLAS control functions used only from Lua. */
+extern int (*_blas_control_ref)(int n);
+int (*_blas_control_ref)(int n) = gsl_shell_blas_set_threads;
+
+extern int (*_array_eval_ref)(int, void *, const double *, int, const double *,
+                              size_t, size_t, size_t, double *, size_t, int);
+int (*_array_eval_ref)(int, void *, const double *, int, const double *,
+                       size_t, size_t, size_t, double *, size_t, int) = gsl_shell_array_eval;
+
+extern void (*_rng_skip_ref)(const gsl_rng *, double);
+void (*_rng_skip_ref)(const gsl_rng *, double) = gsl_shell_rng_skip;
+
+extern int (*_column_kernels_ref)(const double *, size_t, size_t *);
+int (*_column_kernels_ref)(const double *, size_t, size_t *) = gsl_shell_column_check_increasing;
+
 struct gsl_shell_state* global_state;
 
 void
@@ -0,0 +1,378 @@
+
+/* lua-parallel.c
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Pool of worker threads, each one with its own Lua state, used to run
+   a Lua chunk concurrently. The Lua states are kept alive between the
+   calls so that the loaded modules and the compiled traces are reused.
+
+   Only nil, booleans, numbers and strings can be passed to the workers
+   and returned from them. Large data are shared by passing the address
+   of the memory as a number. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#include "lua-parallel.h"
+#include "lua-gsl.h"
+#include "lua-filesystem.h"
+
+#define PARALLEL_MAX_WORKERS 64
+#define PARALLEL_MAX_ARGS 32
+
+struct parallel_value {
+  int type;
+  lua_Number number;
+  const char *str;
+  size_t len;
+};
+
+struct parallel_job {
+  const char *code;
+  size_t code_len;
+  int nworkers;
+  int nargs;
+  struct parallel_value args[PARALLEL_MAX_ARGS];
+};
+
+struct parallel_worker {
+  lua_State *L;
+  pthread_t thread;
+  int index;
+  int status;
+  const struct parallel_job *job;
+};
+
+static struct parallel_worker workers[PARALLEL_MAX_WORKERS];
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *chunks_cache_key = "GSL.parallel.chunks";
+
+static int
+cpu_count (void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo (&info);
+  return (int) info.dwNumberOfProcessors;
+#else
+  long n = sysconf (_SC_NPROCESSORS_ONLN);
+  return (n > 0 ? (int) n : 1);
+#endif
+}
+
+static void
+copy_string_field (lua_State *src, lua_State *dst, const char *table, const char *key)
+{
+  lua_getglobal (src, table);
+  if (lua_istable (src, -1))
+    {
+      lua_getfield (src, -1, key);
+      if (lua_isstring (src, -1))
+        {
+          lua_getglobal (dst, table);
+          lua_pushstring (dst, lua_tostring (src, -1));
+          lua_setfield (dst, -2, key);
+          lua_pop (dst, 1);
+        }
+      lua_pop (src, 1);
+    }
+  lua_pop (src, 1);
+}
+
+static void
+copy_string_global (lua_State *src, lua_State *dst, const char *name)
+{
+  lua_getglobal (src, name);
+  if (lua_isstring (src, -1))
+    {
+      lua_pushstring (dst, lua_tostring (src, -1));
+      lua_setglobal (dst, name);
+    }
+  lua_pop (src, 1);
+}
+
+/* Create a Lua state for a worker. The modules search path is copied
+   from the main Lua state. */
+static lua_State *
+worker_state_new (lua_State *L)
+{
+  lua_State *wl = luaL_newstate ();
+  if (wl == NULL)
+    return NULL;
+
+  lua_gc (wl, LUA_GCSTOP, 0);
+  luaL_openlibs (wl);
+  luaopen_gsl (wl);
+  luaopen_filesystem (wl);
+  lua_gc (wl, LUA_GCRESTART, -1);
+
+  copy_string_field (L, wl, "package", "path");
+  copy_string_field (L, wl, "package", "cpath");
+  copy_string_global (L, wl, "EXEFILE");
+  copy_string_global (L, wl, "DATADIR");
+
+  lua_newtable (wl);
+  lua_setfield (wl, LUA_REGISTRYINDEX, chunks_cache_key);
+
+  return wl;
+}
+
+/* Push on the stack the function for the job's chunk, loading it only
+   the first time it is seen by the worker. */
+static int
+worker_load_chunk (lua_State *L, const struct parallel_job *job)
+{
+  lua_getfield (L, LUA_REGISTRYINDEX, chunks_cache_key);
+  lua_pushlstring (L, job->code, job->code_len);
+  lua_pushvalue (L, -1);
+  lua_rawget (L, -3);
+  if (lua_isnil (L, -1))
+    {
+      int status;
+      lua_pop (L, 1);
+      status = luaL_loadbuffer (L, job->code, job->code_len, "=(parallel)");
+      if (status != 0)
+        return status;
+      lua_pushvalue (L, -2);
+      lua_pushvalue (L, -2);
+      lua_rawset (L, -5);
+    }
+  lua_replace (L, -3);
+  lua_pop (L, 1);
+  return 0;
+}
+
+static void
+push_value (lua_State *L, const struct parallel_value *v)
+{
+  switch (v->type)
+    {
+    case LUA_TBOOLEAN:
+      lua_pushboolean (L, (int) v->number);
+      break;
+    case LUA_TNUMBER:
+      lua_pushnumber (L, v->number);
+      break;
+    case LUA_TSTRING:
+      lua_pushlstring (L, v->str, v->len);
+      break;
+    default:
+      lua_pushnil (L);
+    }
+}
+
+static void *
+worker_run (void *data)
+{
+  struct parallel_worker *w = (struct parallel_worker *) data;
+  const struct parallel_job *job = w->job;
+  lua_State *L = w->L;
+  int k;
+
+  lua_settop (L, 0);
+  w->status = worker_load_chunk (L, job);
+  if (w->status != 0)
+    return NULL;
+
+  lua_pushinteger (L, w->index + 1);
+  lua_pushinteger (L, job->nworkers);
+  for (k = 0; k < job->nargs; k++)
+    push_value (L, &job->args[k]);
+
+  w->status = lua_pcall (L, job->nargs + 2, 1, 0);
+  return NULL;
+}
+
+/* Copy the value returned by a worker to the main Lua state. */
+static void
+push_worker_result (lua_State *L, lua_State *wl)
+{
+  switch (lua_type (wl, -1))
+    {
+    case LUA_TBOOLEAN:
+      lua_pushboolean (L, lua_toboolean (wl, -1));
+      break;
+    case LUA_TNUMBER:
+      lua_pushnumber (L, lua_tonumber (wl, -1));
+      break;
+    case LUA_TSTRING:
+      {
+        size_t len;
+        const char *s = lua_tolstring (wl, -1, &len);
+        lua_pushlstring (L, s, len);
+        break;
+      }
+    default:
+      lua_pushnil (L);
+    }
+}
+
+/* parallel.run(code, nworkers, ...)
+
+   Run the Lua chunk "code", given as source or bytecode, in "nworkers"
+   threads. Each worker calls the chunk with the arguments (k, nworkers,
+   ...) where k is the index of the worker starting from 1. Return a
+   table with the value returned by each worker. */
+static int
+parallel_run (lua_State *L)
+{
+  struct parallel_job job[1];
+  int nargs = lua_gettop (L) - 2;
+  int k, nstarted, failed = -1;
+
+  job->code = luaL_checklstring (L, 1, &job->code_len);
+  job->nworkers = luaL_checkint (L, 2);
+
+  if (job->nworkers < 1 || job->nworkers > PARALLEL_MAX_WORKERS)
+    return luaL_error (L, "number of workers should be between 1 and %d", PARALLEL_MAX_WORKERS);
+  if (nargs > PARALLEL_MAX_ARGS)
+    return luaL_error (L, "too many arguments for parallel workers");
+
+  job->nargs = nargs;
+  for (k = 0; k < nargs; k++)
+    {
+      struct parallel_value *v = &job->args[k];
+      int idx = k + 3;
+      v->type = lua_type (L, idx);
+      switch (v->type)
+        {
+        case LUA_TNIL:
+          break;
+        case LUA_TBOOLEAN:
+          v->number = lua_toboolean (L, idx);
+          break;
+        case LUA_TNUMBER:
+          v->number = lua_tonumber (L, idx);
+          break;
+        case LUA_TSTRING:
+          v->str = lua_tolstring (L, idx, &v->len);
+          break;
+        default:
+          return luaL_error (L, "invalid argument #%d for parallel workers, %s not allowed",
+                             idx, lua_typename (L, v->type));
+        }
+    }
+
+  pthread_mutex_lock (&pool_mutex);
+
+  for (k = 0; k < job->nworkers; k++)
+    {
+      struct parallel_worker *w = &workers[k];
+      if (w->L == NULL)
+        {
+          w->L = worker_state_new (L);
+          if (w->L == NULL)
+            {
+              pthread_mutex_unlock (&pool_mutex);
+              return luaL_error (L, "cannot create worker state: not enough memory");
+            }
+        }
+      w->index = k;
+      w->job = job;
+    }
+
+  for (nstarted = 0; nstarted < job->nworkers; nstarted++)
+    {
+      struct parallel_worker *w = &workers[nstarted];
+      if (pthread_create (&w->thread, NULL, worker_run, w) != 0)
+        break;
+    }
+
+  /* if a thread cannot be created the remaining workers are run
+     sequentially in the current thread */
+  for (k = nstarted; k < job->nworkers; k++)
+    worker_run (&workers[k]);
+
+  for (k = 0; k < nstarted; k++)
+    pthread_join (workers[k].thread, NULL);
+
+  lua_createtable (L, job->nworkers, 0);
+  for (k = 0; k < job->nworkers; k++)
+    {
+      struct parallel_worker *w = &workers[k];
+      if (w->status != 0 && failed < 0)
+        {
+          failed = k;
+          continue;
+        }
+      if (w->status == 0)
+        {
+          push_worker_result (L, w->L);
+          lua_rawseti (L, -2, k + 1);
+        }
+    }
+
+  if (failed >= 0)
+    {
+      lua_State *wl = workers[failed].L;
+      const char *msg = lua_tostring (wl, -1);
+      lua_pushfstring (L, "parallel worker %d: %s", failed + 1, msg ? msg : "(error object is not a string)");
+      for (k = 0; k < job->nworkers; k++)
+        lua_settop (workers[k].L, 0);
+      pthread_mutex_unlock (&pool_mutex);
+      return lua_error (L);
+    }
+
+  for (k = 0; k < job->nworkers; k++)
+    lua_settop (workers[k].L, 0);
+
+  pthread_mutex_unlock (&pool_mutex);
+  return 1;
+}
+
+static int
+parallel_cpu_count (lua_State *L)
+{
+  lua_pushinteger (L, cpu_count ());
+  return 1;
+}
+
+static int
+parallel_max_workers (lua_State *L)
+{
+  lua_pushinteger (L, PARALLEL_MAX_WORKERS);
+  return 1;
+}
+
+static const struct luaL_Reg parallel_functions[] = {
+  {"run",         parallel_run},
+  {"cpu_count",   parallel_cpu_count},
+  {"max_workers", parallel_max_workers},
+  {NULL, NULL}
+};
+
+int
+luaopen_parallel (lua_State *L)
+{
+  luaL_register (L, "parallel", parallel_functions);
+  lua_pop (L, 1);
+  return 0;
+}
@@ -0,0 +1,181 @@
+
+/* rnd-fill.c
+ *
+ * Copyright (C) 2009-2022 Francesco Abbate
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Generation of the random variates of a distribution for all the
+   elements of a matrix. The elements are divided in as many contiguous
+   ranges as the random number generators given so that the result
+   depends only on the generators and not on the number of threads
+   used. */
+
+#include <pthread.h>
+
+#include "rnd-fill.h"
+
+#define RND_FILL_MAX_THREADS 64
+/* minimum number of elements to use a thread for each generator */
+#define RND_FILL_MIN_CHUNK 4096
+
+typedef double (*d0_fn) (const gsl_rng *);
+typedef double (*d1_fn) (const gsl_rng *, double);
+typedef double (*d2_fn) (const gsl_rng *, double, double);
+typedef double (*d3_fn) (const gsl_rng *, double, double, double);
+typedef double (*du_fn) (const gsl_rng *, unsigned int);
+typedef unsigned int (*u1_fn) (const gsl_rng *, double);
+typedef unsigned int (*udu_fn) (const gsl_rng *, double, unsigned int);
+typedef unsigned int (*uuu_fn) (const gsl_rng *, unsigned int, unsigned int, unsigned int);
+
+struct rnd_fill_job {
+  int kind;
+  void *fn;
+  double p[RND_FILL_MAX_PARAMS];
+  gsl_rng **rs;
+  int nr;
+  double *y;
+  size_t n, n2, ytda;
+  /* the job fills the ranges first, first + step, ... */
+  int first, step;
+};
+
+/* Fill the elements from "start" to "end" - 1, in row-major order,
+   using the generator r. */
+static void
+fill_range (const struct rnd_fill_job *job, const gsl_rng *r, size_t start, size_t end)
+{
+  const double *p = job->p;
+  size_t i = start / job->n2, j = start % job->n2, e;
+
+  for (e = start; e < end; e++)
+    {
+      double v;
+      switch (job->kind)
+        {
+        case RND_FILL_D0:
+          v = ((d0_fn) job->fn) (r);
+          break;
+        case RND_FILL_D1:
+          v = ((d1_fn) job->fn) (r, p[0]);
+          break;
+        case RND_FILL_D2:
+          v = ((d2_fn) job->fn) (r, p[0], p[1]);
+          break;
+        case RND_FILL_D3:
+          v = ((d3_fn) job->fn) (r, p[0], p[1], p[2]);
+          break;
+        case RND_FILL_DU:
+          v = ((du_fn) job->fn) (r, (unsigned int) p[0]);
+          break;
+        case RND_FILL_U1:
+          v = ((u1_fn) job->fn) (r, p[0]);
+          break;
+        case RND_FILL_UDU:
+          v = ((udu_fn) job->fn) (r, p[0], (unsigned int) p[1]);
+          break;
+        default:
+          v = ((uuu_fn) job->fn) (r, (unsigned int) p[0], (unsigned int) p[1], (unsigned int) p[2]);
+          break;
+        }
+
+      job->y[i * job->ytda + j] = v;
+      if (++j == job->n2)
+        {
+          j = 0;
+          i++;
+        }
+    }
+}
+
+static void *
+rnd_fill_run (void *data)
+{
+  struct rnd_fill_job *job = (struct rnd_fill_job *) data;
+  int k;
+
+  for (k = job->first; k < job->nr; k += job->step)
+    {
+      size_t start = (job->n * k) / job->nr, end = (job->n * (k + 1)) / job->nr;
+      fill_range (job, job->rs[k], start, end);
+    }
+
+  return NULL;
+}
+
+/* Fill the n1 x n2 matrix y with random variates of the distribution
+   "fn" using the nr generators "rs". The k-th generator is used for the
+   k-th range of elements and, for large matrices, each generator is
+   used in a separate thread. */
+void
+gsl_shell_rnd_fill (int kind, void *fn, gsl_rng **rs, int nr,
+                    const double *params, int nparams,
+                    double *y, size_t n1, size_t n2, size_t ytda)
+{
+  struct rnd_fill_job jobs[RND_FILL_MAX_THREADS];
+  pthread_t threads[RND_FILL_MAX_THREADS];
+  size_t n = n1 * n2;
+  int k, nthreads, nstarted;
+
+  if (n == 0 || nr < 1)
+    return;
+
+  nthreads = (nr < RND_FILL_MAX_THREADS ? nr : RND_FILL_MAX_THREADS);
+  if ((size_t) nthreads > n / RND_FILL_MIN_CHUNK)
+    nthreads = n / RND_FILL_MIN_CHUNK;
+  if (nthreads < 1)
+    nthreads = 1;
+
+  for (k = 0; k < nthreads; k++)
+    {
+      struct rnd_fill_job *job = &jobs[k];
+      int i;
+      job->kind = kind;
+      job->fn = fn;
+      for (i = 0; i < RND_FILL_MAX_PARAMS; i++)
+        job->p[i] = (i < nparams ? params[i] : 0.0);
+      job->rs = rs;
+      job->nr = nr;
+      job->y = y;
+      job->n = n;
+      job->n2 = n2;
+      job->ytda = ytda;
+      job->first = k;
+      job->step = nthreads;
+    }
+
+  for (nstarted = 1; nstarted < nthreads; nstarted++)
+    {
+      if (pthread_create (&threads[nstarted], NULL, rnd_fill_run, &jobs[nstarted]) != 0)
+        break;
+    }
+
+  rnd_fill_run (&jobs[0]);
+  for (k = nstarted; k < nthreads; k++)
+    rnd_fill_run (&jobs[k]);
+
+  for (k = 1; k < nstarted; k++)
+    pthread_join (threads[k], NULL);
+}
+
+/* Advance the generator by n draws. */
+void
+gsl_shell_rng_skip (const gsl_rng *r, double n)
+{
+  double k;
+  for (k = 0; k < n; k++)
+    gsl_rng_get (r);
+}
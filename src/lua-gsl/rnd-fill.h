@@ -0,0 +1,36 @@
+#ifndef RND_FILL_H
+#define RND_FILL_H
+
+#include <stddef.h>
+
+#include <gsl/gsl_rng.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Signature of the random variate generators, after the gsl_rng
+   argument. d is a real parameter and u an unsigned one. The "u" kinds
+   return an unsigned int, the other ones a double. */
+enum rnd_fill_kind {
+  RND_FILL_D0 = 0,  /* double f(r) */
+  RND_FILL_D1,      /* double f(r, double) */
+  RND_FILL_D2,      /* double f(r, double, double) */
+  RND_FILL_D3,      /* double f(r, double, double, double) */
+  RND_FILL_DU,      /* double f(r, unsigned) */
+  RND_FILL_U1,      /* unsigned f(r, double) */
+  RND_FILL_UDU,     /* unsigned f(r, double, unsigned) */
+  RND_FILL_UUU,     /* unsigned f(r, unsigned, unsigned, unsigned) */
+};
+
+#define RND_FILL_MAX_PARAMS 3
+
+extern void gsl_shell_rnd_fill (int kind, void *fn, gsl_rng **rs, int nr,
+                                const double *params, int nparams,
+                                double *y, size_t n1, size_t n2, size_t ytda);
+
+extern void gsl_shell_rng_skip (const gsl_rng *r, double n);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,114 @@
+-- Round trip of the QOI output of plot:save. The image is decoded
+-- following the QOI specification and compared with the pixels of the
+-- PPM image saved from the same plot. The plot has black axes, text and
+-- lines, the colors more exposed to errors in the color index.
+
+local bit = require 'bit'
+local band, rshift = bit.band, bit.rshift
+
+local function read_file(fn)
+   local f = assert(io.open(fn, 'rb'))
+   local s = f:read('*a')
+   f:close()
+   return s
+end
+
+local function be32(s, i)
+   local a, b, c, d = s:byte(i, i + 3)
+   return ((a * 256 + b) * 256 + c) * 256 + d
+end
+
+-- Return width, height and a function giving the RGBA values of the
+-- pixel k, starting from zero.
+local function qoi_decode(s)
+   assert(s:sub(1, 4) == 'qoif', 'invalid QOI magic')
+   local w, h = be32(s, 5), be32(s, 9)
+   local index = {}
+   for k = 0, 63 do index[k] = {0, 0, 0, 0} end
+   local r, g, b, a = 0, 0, 0, 255
+   local out = {}
+   local n, p = 0, 15
+   local function push()
+      index[(r*3 + g*5 + b*7 + a*11) % 64] = {r, g, b, a}
+      out[n] = {r, g, b, a}
+      n = n + 1
+   end
+   while n < w * h do
+      local b1 = s:byte(p)
+      p = p + 1
+      if b1 == 0xfe then
+         r, g, b = s:byte(p, p + 2)
+         p = p + 3
+         push()
+      elseif b1 == 0xff then
+         r, g, b, a = s:byte(p, p + 3)
+         p = p + 4
+         push()
+      elseif rshift(b1, 6) == 0 then
+         local e = index[b1]
+         r, g, b, a = e[1], e[2], e[3], e[4]
+         push()
+      elseif rshift(b1, 6) == 1 then
+         r = (r + band(rshift(b1, 4), 3) - 2) % 256
+         g = (g + band(rshift(b1, 2), 3) - 2) % 256
+         b = (b + band(b1, 3) - 2) % 256
+         push()
+      elseif rshift(b1, 6) == 2 then
+         local b2 = s:byte(p)
+         p = p + 1
+         local vg = band(b1, 63) - 32
+         r = (r + vg - 8 + rshift(b2, 4)) % 256
+         g = (g + vg) % 256
+         b = (b + vg - 8 + band(b2, 15)) % 256
+         push()
+      else
+         for k = 0, band(b1, 63) do
+            out[n] = {r, g, b, a}
+            n = n + 1
+         end
+      end
+   end
+   assert(s:sub(p, p + 7) == '\0\0\0\0\0\0\0\1', 'invalid QOI end marker')
+   return w, h, function(k) return unpack(out[k]) end
+end
+
+local function ppm_read(s)
+   local w, h, offs = s:match('^P6%s+(%d+)%s+(%d+)%s+255%s()')
+   assert(w, 'invalid PPM header')
+   return tonumber(w), tonumber(h), function(k)
+      return s:byte(offs + 3*k, offs + 3*k + 2)
+   end
+end
+
+local p = graph.plot('QOI round trip')
+p:addline(graph.fxline(sin, 0, 2*pi), 'black')
+p:add(graph.rect(1, -0.5, 2, 0.5), 'red')
+p:addline(graph.fxline(cos, 0, 2*pi), 'blue')
+
+local base = os.tmpname()
+p:save(base .. '.qoi', 320, 240)
+p:save(base, 320, 240)
+
+local qw, qh, qpixel = qoi_decode(read_file(base .. '.qoi'))
+local pw, ph, ppixel = ppm_read(read_file(base .. '.ppm'))
+os.remove(base .. '.qoi')
+os.remove(base .. '.ppm')
+os.remove(base)
+
+assert(qw == 320 and qh == 240 and pw == 320 and ph == 240, 'wrong image size')
+
+local errors, black = 0, 0
+for k = 0, qw * qh - 1 do
+   local r, g, b, a = qpixel(k)
+   local r0, g0, b0 = ppixel(k)
+   if r ~= r0 or g ~= g0 or b ~= b0 or a ~= 255 then
+      errors = errors + 1
+   end
+   if r0 == 0 and g0 == 0 and b0 == 0 then black = black + 1 end
+end
+
+assert(black > 0, 'the image has no black pixels')
+if errors > 0 then
+   error(string.format('QOI image differs from PPM in %d pixels', errors))
+end
+print('QOI round trip: OK')
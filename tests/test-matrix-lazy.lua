@@ -0,0 +1,36 @@
+-- Indexing of lazy matrix expressions and in-place products. The lazy
+-- expressions should give the same elements as the eager operators.
+
+local function check_equal(a, b, msg)
+   local n1, n2 = b:dim()
+   for i = 1, n1 do
+      for j = 1, n2 do
+         if abs(a[i][j] - b:get(i, j)) > 1e-12 * (1 + abs(b:get(i, j))) then
+            error(string.format('%s: element (%d, %d) differs', msg, i, j))
+         end
+      end
+   end
+end
+
+local a = matrix.new(4, 4, |i, j| i + 10*j)
+local b = matrix.new(4, 4, |i, j| i * j - 3)
+
+check_equal(matrix.lazy(a)*2 + b, a*2 + b, 'lazy sum')
+check_equal(-matrix.lazy(a), -a, 'lazy negation')
+check_equal(b - matrix.lazy(a)/4, b - a/4, 'lazy difference')
+assert((matrix.lazy(a)*2 + b):get(2, 3) == 2*a:get(2, 3) + b:get(2, 3), 'lazy get')
+
+local c = a:copy()
+c:mul_inplace(b)
+check_equal(c, a*b, 'in-place product')
+
+c = a:copy()
+c:mul_inplace(c)
+check_equal(c, a*a, 'in-place square')
+
+local r = matrix.new(2, 4, |i, j| i - j)
+local ref = r * b
+r:mul_inplace(matrix.lazy(b) + 0)
+check_equal(r, ref, 'in-place product by lazy expression')
+
+print('Lazy matrix expressions: OK')
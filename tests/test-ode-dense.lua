@@ -0,0 +1,54 @@
+-- Accuracy of the dense output and of the event location of the ODE
+-- solvers on the harmonic oscillator x'' = -x, with solution x = sin(t).
+
+local function oscillator(method, eps_abs)
+   local s = num.ode {N= 2, eps_abs= eps_abs, method= method}
+   s:init(0, 1e-3, |t, x, v| v, -x, 0, 1)
+   return s
+end
+
+for _, test in ipairs {{'rkf45', 1e-10}, {'rk8pd', 1e-12}} do
+   local method, eps_abs = test[1], test[2]
+
+   -- error of the values at the end of the steps
+   local s = oscillator(method, eps_abs)
+   local err_step = 0
+   while s.t < 20 do
+      s:step(20)
+      err_step = max(err_step, abs(s.y[1] - sin(s.t)))
+   end
+
+   -- the sampled values should have about the same error
+   s = oscillator(method, eps_abs)
+   local err_sample = 0
+   for t, x in s:sample(20, 0.013) do
+      err_sample = max(err_sample, abs(x - sin(t)))
+   end
+   if err_sample > 4 * err_step then
+      error(string.format('%s: dense output error %g, step error %g', method, err_sample, err_step))
+   end
+
+   -- the zeros of x are at k*pi
+   s = oscillator(method, eps_abs)
+   local k = 0
+   for t in |_| s:evolve_until(20, |t, x| x) do
+      k = k + 1
+      if abs(t - k * pi) > 100 * eps_abs then
+         error(string.format('%s: event at %.15g, expected %.15g', method, t, k * pi))
+      end
+   end
+   assert(k == 6, 'wrong number of events')
+
+   -- g is exactly zero at the first event, at t = 1, and changes sign
+   -- again at t = 1.02, inside the first step of the following call
+   local g = |t| t < 1.02 and 1 - t or 1
+   s = oscillator(method, eps_abs)
+   local t1 = s:evolve_until(1.015, g)
+   assert(t1 == 1 and g(t1) == 0, 'event with g equal to zero not found')
+   local t2 = s:evolve_until(5, g)
+   if not t2 or abs(t2 - 1.02) > 1e-9 then
+      error(string.format('%s: event after g equal to zero not found', method))
+   end
+end
+
+print('ODE dense output: OK')